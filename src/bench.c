@@ -0,0 +1,79 @@
+/*
+  Xiphos, a UCI chess engine
+  Copyright (C) 2018, 2019 Milos Tatarevic
+
+  Xiphos is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Xiphos is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+
+#include "search.h"
+#include "uci.h"
+
+#define GO_CMD_SIZE 32
+
+// a mix of opening, middlegame and endgame positions
+static char *bench_fens[] =
+{
+  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -",
+  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+  "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -",
+  "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - -",
+  "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - -",
+  "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - -",
+  "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - -",
+  "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq -",
+  "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - -",
+  "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - -",
+  "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ -",
+  "r1bq1b1r/ppp3kp/2n2p2/8/2BQ4/4B3/PPP2PPP/R3K2R w KQ -",
+  "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - -",
+  "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - -",
+  "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - -",
+  "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - -",
+  "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - -",
+  "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - -",
+  "2K5/p7/7P/5pR1/8/5k2/r7/8 w - -",
+  "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - -",
+  "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - -",
+  "8/2p5/8/2kPKp1p/2p4P/2P5/3P4/8 w - -",
+  "8/1p3pp1/7p/5P1P/2k3P1/8/2K2P2/8 w - -",
+  "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - -",
+};
+
+// each position is searched from a fresh state, the node count only
+// depends on the search tree when a single thread is used
+uint64_t bench(int depth)
+{
+  int i, t;
+  uint64_t nodes;
+  char go_cmd[GO_CMD_SIZE];
+
+  nodes = 0;
+  for (i = 0; i < sizeof(bench_fens) / sizeof(char *); i ++)
+  {
+    full_reset_search_data();
+    read_fen(search_settings.sd, bench_fens[i]);
+
+    snprintf(go_cmd, GO_CMD_SIZE, "depth %d", depth);
+    parse_go_cmd(go_cmd);
+    start_search();
+    wait_search();
+
+    for (t = 0; t < search_settings.max_threads; t ++)
+      nodes += search_settings.threads_search_data[t].nodes;
+  }
+
+  return nodes;
+}
@@ -18,9 +18,11 @@
 
 #include "bitboard.h"
 #include "game.h"
+#include "material.h"
 #include "pawn_eval.h"
 #include "phash.h"
 #include "position.h"
+#include "search.h"
 #include "tables.h"
 
 #define SAFE_CHECK_BONUS          3
@@ -36,19 +38,24 @@
 
 const int k_cnt_mul[K_CNT_LIMIT] = { 0, 3, 7, 12, 16, 18, 19, 20 };
 
-int eval(position_t *pos)
+int eval(search_data_t *sd)
 {
   int side, score, score_mid, score_end, pcnt, sq, k_sq_f, k_sq_o,
-      piece_o, open_file, initiative_bonus, k_score[N_SIDES], k_cnt[N_SIDES];
+      piece_o, open_file, semi_open_files_f, semi_open_files_o,
+      initiative_bonus, k_score[N_SIDES], k_cnt[N_SIDES];
   uint64_t b, b0, b1, k_zone, occ, occ_f, occ_o, occ_o_np, occ_o_nk, occ_x,
            p_occ, p_occ_f, p_occ_o, n_att, b_att, r_att, pushed_passers, safe_area,
            p_safe_att, p_pushed[N_SIDES], mob_area[N_SIDES], att_area[N_SIDES],
            d_att_area[N_SIDES], checks[N_SIDES], piece_att[N_SIDES][N_PIECES];
   phash_data_t phash_data;
+  material_item_t *material_data;
+  position_t *pos;
 
-  phash_data = pawn_eval(pos);
-  score_mid = pos->score_mid + phash_data.score_mid;
-  score_end = pos->score_end + phash_data.score_end;
+  pos = sd->pos;
+  phash_data = pawn_eval(sd);
+  material_data = get_material_data(sd->material_items, pos->material_key);
+  score_mid = pos->score_mid + phash_data.score_mid + material_data->score_mid;
+  score_end = pos->score_end + phash_data.score_end + material_data->score_end;
 
   p_occ = pos->piece_occ[PAWN];
   occ = _occ(pos);
@@ -58,7 +65,7 @@ int eval(position_t *pos)
   {
     p_occ_f = p_occ & pos->occ[side];
     p_pushed[side] = pushed_pawns(p_occ_f, ~occ, side);
-    piece_att[side][PAWN] = pawn_attacks(p_occ_f, side);
+    piece_att[side][PAWN] = phash_data.pawn_attacks[side];
   }
 
   for (side = WHITE; side < N_SIDES; side ++)
@@ -70,9 +77,10 @@ int eval(position_t *pos)
     occ_f = pos->occ[side];
     occ_o = pos->occ[side ^ 1];
     p_occ_f = p_occ & occ_f;
-    p_occ_o = p_occ & occ_o;
     occ_o_nk = occ_o & ~_b(k_sq_o);
     occ_x = occ ^ pos->piece_occ[QUEEN];
+    semi_open_files_f = phash_data.semi_open_files[side];
+    semi_open_files_o = phash_data.semi_open_files[side ^ 1];
 
     n_att = knight_attack(occ, k_sq_o);
     b_att = bishop_attack(occ_x, k_sq_o);
@@ -88,10 +96,9 @@ int eval(position_t *pos)
     k_score[side] = k_cnt[side] = 0;
 
     #define _score_rook_open_files                                             \
-      b1 = _b_file[_file(sq)];                                                 \
-      if (!(b1 & p_occ_f))                                                     \
+      if (semi_open_files_f & (1 << _file(sq)))                                \
       {                                                                        \
-        open_file = !(b1 & p_occ_o);                                           \
+        open_file = (semi_open_files_o >> _file(sq)) & 1;                      \
         score_mid += rook_file_bonus[PHASE_MID][open_file];                    \
         score_end += rook_file_bonus[PHASE_END][open_file];                    \
       }
@@ -163,13 +170,6 @@ int eval(position_t *pos)
         (pos->piece_occ[KNIGHT] | pos->piece_occ[BISHOP]);
     score_mid += _popcnt(b) * BEHIND_PAWN_BONUS;
 
-    // bishop pair bonus
-    if (_popcnt(pos->piece_occ[BISHOP] & occ_f) >= 2)
-    {
-      score_mid += bishop_pair[PHASE_MID];
-      score_end += bishop_pair[PHASE_END];
-    }
-
     score_mid = -score_mid;
     score_end = -score_end;
   }
@@ -258,19 +258,17 @@ int eval(position_t *pos)
 
   // initiative
   initiative_bonus =
-    initiative[0] * _popcnt(p_occ) +
-    initiative[1] * ((p_occ & _B_Q_SIDE) && (p_occ & _B_K_SIDE)) +
-    initiative[2] * (_popcnt(occ & ~p_occ) == 2) -
-    initiative[3];
+    material_data->initiative +
+    initiative[1] * ((p_occ & _B_Q_SIDE) && (p_occ & _B_K_SIDE));
 
   score_end += _sign(score_end) * _max(initiative_bonus, -_abs(score_end));
 
   // score interpolation
-  if (pos->phase >= TOTAL_PHASE)
+  if (material_data->phase >= TOTAL_PHASE)
     score = score_end;
   else
-    score = ((score_mid * (TOTAL_PHASE - pos->phase)) +
-             (score_end * pos->phase)) >> PHASE_SHIFT;
+    score = ((score_mid * (TOTAL_PHASE - material_data->phase)) +
+             (score_end * material_data->phase)) >> PHASE_SHIFT;
 
   return score + TEMPO;
 }
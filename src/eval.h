@@ -21,12 +21,13 @@
 
 #include "game.h"
 #include "position.h"
+#include "search.h"
 
 #define CASTLING_BONUS      20
 
 extern const int piece_value[N_PIECES];
 extern const int piece_phase[N_PIECES];
 
-int eval(position_t *);
+int eval(search_data_t *);
 
 #endif
@@ -48,6 +48,7 @@
 
 #define EMPTY                        0xf
 #define P_LIMIT                      (EMPTY + 1)
+#define H_LIMIT                      (N_SIDES * N_PIECES)
 
 #define SIDE_SHIFT                   3
 #define CHANGE_SIDE                  (1 << SIDE_SHIFT)
@@ -75,6 +76,7 @@
 #define _side(piece)                 ((piece) >> SIDE_SHIFT)
 #define _to_white(piece)             ((piece) & (CHANGE_SIDE - 1))
 #define _equal_to(piece, w_piece)    (_to_white(piece) == (w_piece))
+#define _h_piece(piece)              ((piece) - _side(piece) * (CHANGE_SIDE - N_PIECES))
 
 #define _is_mate_score(score)        ((score) <= -MATE_SCORE + MAX_PLY || \
                                       (score) >= MATE_SCORE - MAX_PLY)
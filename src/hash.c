@@ -16,46 +16,83 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include <time.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "hash.h"
+#include "material.h"
+#include "memory.h"
 #include "move.h"
+#include "numa.h"
+#include "util.h"
 
+#define HASH_BUCKET_SIZE    6
+#define HASH_ITER_MASK      0x3f
+#define HASH_FULL_SAMPLE    1000
+#define HASH_TEST_MB        2
+#define HASH_TEST_SCORES    1000
+
+#define Z_KEYS_SEED         UINT64_C(0x9e3779b97f4a7c15)
+
+#define HASH_FILE_MAGIC     "XIPHOSTT"
+#define HASH_FILE_VERSION   3
+#define HASH_FILE_OFFSET    4096
+
+// all items of a bucket share a single cache line, an item takes 10 bytes:
+// the upper 16 bits of the hash key xored with the folded data, and the data
 typedef struct {
-  uint64_t mask;
-  hash_data_t data;
-} hash_item_t;
+  uint16_t keys[HASH_BUCKET_SIZE];
+  uint32_t padding;
+  hash_data_t data[HASH_BUCKET_SIZE];
+} __attribute__ ((aligned (64))) hash_bucket_t;
+_Static_assert(sizeof(hash_bucket_t) == 64, "hash_bucket_t size error");
+
+// the data is placed at a page aligned offset, so the file can be mapped,
+// shared memory segments use the same layout, with the number of processes
+// attached to the segment and whether its name was already removed
+typedef struct {
+  char magic[8];
+  uint32_t version, bucket_size, iter, users, unlinked;
+  uint64_t z_keys_seed, z_keys_check, size;
+} hash_file_header_t;
 
 struct {
-  hash_item_t *items;
+  hash_bucket_t *buckets;
+  hash_file_header_t *header;
   uint64_t size, mask;
   uint32_t iter;
+  int mode, shm_creator;
+  char shm_name[HASH_SHM_NAME_SIZE], mapped_shm_name[HASH_SHM_NAME_SIZE];
+  mem_block_t mem;
 } hash_store;
 
+typedef struct {
+  hash_bucket_t *buckets;
+  uint64_t mask, from, to;
+} hash_rehash_t;
+
 shared_z_keys_t shared_z_keys;
+uint64_t z_keys_state;
 
+// xorshift64*, the keys have to be the same in every run
 uint64_t rand64()
 {
-  int i;
-  uint64_t r;
-
-  r = 0;
-  for (i = 0; i < 8; i ++)
-    r |= (uint64_t)(rand() & 0xff) << (i << 3);
-  return r;
+  z_keys_state ^= z_keys_state >> 12;
+  z_keys_state ^= z_keys_state << 25;
+  z_keys_state ^= z_keys_state >> 27;
+  return z_keys_state * UINT64_C(0x2545f4914f6cdd1d);
 }
 
 void init_z_keys()
 {
   int i, j;
 
+  z_keys_state = Z_KEYS_SEED;
   for (i = 0; i < BOARD_SIZE; i ++)
     for (j = 0; j < Z_KEYS_MAX_INDEX; j ++)
-      shared_z_keys.positions[i][j] = rand64();
+      shared_z_keys.positions[i][j] = (j == EMPTY) ? 0 : rand64();
 
   for (i = 0; i < C_FLAG_MAX; i ++)
     shared_z_keys.c_flags[i] = rand64();
@@ -63,6 +100,49 @@ void init_z_keys()
   shared_z_keys.side_flag = rand64();
 }
 
+static uint64_t z_keys_check()
+{
+  int i;
+  uint64_t check, *keys;
+
+  check = 0;
+  keys = (uint64_t *)&shared_z_keys;
+  for (i = 0; i < sizeof(shared_z_keys) / sizeof(uint64_t); i ++)
+    check = (check ^ keys[i]) * UINT64_C(0x100000001b3);
+  return check;
+}
+
+// calculate the keys from scratch, make_move updates them incrementally
+void set_hash_keys(search_data_t *sd)
+{
+  int sq, piece;
+  uint64_t hash_key;
+  position_t *pos;
+
+  pos = sd->pos;
+  hash_key = pos->phash_key = pos->material_key = 0;
+  for (sq = 0; sq < BOARD_SIZE; sq ++)
+  {
+    piece = pos->board[sq];
+    hash_key ^= shared_z_keys.positions[sq][piece];
+    if (_equal_to(piece, PAWN) || _equal_to(piece, KING))
+      pos->phash_key ^= shared_z_keys.positions[sq][piece];
+    if (piece != EMPTY)
+      pos->material_key += _material_key(piece);
+  }
+
+  if (pos->side == BLACK)
+    hash_key ^= shared_z_keys.side_flag;
+  if (pos->c_flag)
+    hash_key ^= shared_z_keys.c_flags[pos->c_flag];
+  if (pos->ep_sq != NO_SQ)
+    hash_key ^= shared_z_keys.positions[pos->ep_sq][Z_KEYS_EP_FLAG];
+
+  sd->hash_key = hash_key;
+  sd->hash_keys_cnt = 0;
+  sd->hash_keys[sd->hash_keys_cnt] = hash_key;
+}
+
 int adjust_hash_score(int score, int ply)
 {
   if (score >= MATE_SCORE - MAX_PLY)
@@ -81,80 +161,537 @@ int to_hash_score(int score, int ply)
   return score;
 }
 
+static inline hash_bucket_t *get_bucket(uint64_t hash_key)
+{
+  return hash_store.buckets + (hash_key & hash_store.mask);
+}
+
+// a torn write (key and data written by different threads) fails the check
+static inline uint16_t item_key(uint64_t hash_key, hash_data_t hash_data)
+{
+  uint64_t raw;
+
+  raw = hash_data.raw;
+  raw ^= raw >> 32;
+  raw ^= raw >> 16;
+  return (hash_key >> 48) ^ raw;
+}
+
+void prefetch_hash_data(uint64_t hash_key)
+{
+  __builtin_prefetch(get_bucket(hash_key));
+}
+
+// the processes sharing a table age the items by the latest search of any
+// of them, the items of a newer search in another process are not old
+static inline uint32_t hash_iter()
+{
+  if (hash_store.header)
+    return __atomic_load_n(&hash_store.header->iter, __ATOMIC_RELAXED) & HASH_ITER_MASK;
+  return hash_store.iter;
+}
+
+// prefer to replace shallow entries left over from the previous searches
+static inline int replace_value(hash_data_t hash_data)
+{
+  return hash_data.depth -
+         8 * ((hash_iter() - hash_data.iter) & HASH_ITER_MASK);
+}
+
 hash_data_t get_hash_data(search_data_t *sd)
 {
-  hash_item_t *hash_item;
+  int i;
+  hash_bucket_t *bucket;
   hash_data_t hash_data;
   move_t hash_move;
 
-  hash_item = hash_store.items + (sd->hash_key & hash_store.mask);
-  hash_data = hash_item->data;
+  sd->hash_stats.probes ++;
 
-  // invalid entry
-  if ((sd->hash_key ^ hash_item->mask) != hash_data.raw)
-    hash_data.raw = 0;
-
-  // corrupted move
-  hash_move = hash_data.move;
-  if (_is_m(hash_move) && !is_pseudo_legal(sd->pos, hash_move))
-    hash_data.raw = 0;
+  bucket = get_bucket(sd->hash_key);
+  for (i = 0; i < HASH_BUCKET_SIZE; i ++)
+  {
+    hash_data = bucket->data[i];
+    if (item_key(sd->hash_key, hash_data) != bucket->keys[i])
+      continue;
+
+    // corrupted move
+    hash_move = hash_data.move;
+    if (_is_m(hash_move) && !is_pseudo_legal(sd->pos, hash_move))
+    {
+      sd->hash_stats.collisions ++;
+      break;
+    }
+
+    sd->hash_stats.hits ++;
+    return hash_data;
+  }
 
+  hash_data.raw = 0;
   return hash_data;
 }
 
 void set_hash_data(search_data_t *sd, move_t move, int score, int static_score,
                    int depth, int ply, int bound)
 {
-  hash_item_t *hash_item;
-  hash_data_t hash_data;
+  int i, r;
+  hash_bucket_t *bucket;
+  hash_data_t hash_data, item_data;
+
+  bucket = get_bucket(sd->hash_key);
+  for (i = 0, r = 0; i < HASH_BUCKET_SIZE; i ++)
+  {
+    item_data = bucket->data[i];
+    if (item_key(sd->hash_key, item_data) == bucket->keys[i] || !item_data.raw)
+    {
+      r = i;
+      break;
+    }
+    if (replace_value(item_data) < replace_value(bucket->data[r]))
+      r = i;
+  }
+
+  if (i == HASH_BUCKET_SIZE)
+    sd->hash_stats.replacements ++;
+
+  hash_data.move = _m_with_score(move, to_hash_score(score, ply));
+  hash_data.static_score = static_score;
+  hash_data.depth = depth;
+  hash_data.bound = bound;
+  hash_data.iter = hash_iter();
+
+  bucket->data[r] = hash_data;
+  bucket->keys[r] = item_key(sd->hash_key, hash_data);
+}
 
-  hash_item = hash_store.items + (sd->hash_key & hash_store.mask);
-  hash_data = hash_item->data;
+// permill of the sampled items written during the current search
+int hash_full()
+{
+  int i, cnt;
+  uint32_t iter;
+  hash_data_t hash_data;
 
-  if ((sd->hash_key ^ hash_item->mask) == hash_data.raw ||
-      hash_data.depth <= depth || hash_data.iter != hash_store.iter)
+  iter = hash_iter();
+  for (i = 0, cnt = 0; i < HASH_FULL_SAMPLE; i ++)
   {
-    hash_data.move = _m_with_score(move, to_hash_score(score, ply));
-    hash_data.static_score = static_score;
-    hash_data.depth = depth;
-    hash_data.bound = bound;
-    hash_data.iter = hash_store.iter;
-
-    hash_item->data = hash_data;
-    hash_item->mask = sd->hash_key ^ hash_data.raw;
+    hash_data = hash_store.buckets[i / HASH_BUCKET_SIZE].data[i % HASH_BUCKET_SIZE];
+    if (hash_data.raw && hash_data.iter == iter)
+      cnt ++;
   }
+  return cnt;
 }
 
 void set_hash_iteration()
 {
-  hash_store.iter ++;
+  if (hash_store.header)
+    hash_store.iter =
+      __atomic_add_fetch(&hash_store.header->iter, 1, __ATOMIC_RELAXED) & HASH_ITER_MASK;
+  else
+    hash_store.iter = (hash_store.iter + 1) & HASH_ITER_MASK;
 }
 
-void reset_hash_key(search_data_t *sd)
+void clear_hash()
 {
-  memset(hash_store.items, 0, hash_store.size);
+  // other processes keep using the shared items
+  if (hash_store.header)
+    return;
+
+  mem_clear(&hash_store.mem, search_settings.max_threads);
   hash_store.iter = 0;
+}
 
-  srand(time(0));
-  init_z_keys();
+// move the items of the old buckets mapped to the given range of new buckets
+static void *rehash_buckets(void *data)
+{
+  int i, j, r, cnt;
+  uint64_t b, k, ratio;
+  hash_rehash_t *rehash;
+  hash_bucket_t *bucket, *src;
+  hash_data_t hash_data;
 
-  sd->hash_key = rand64();
-  sd->hash_keys_cnt = 0;
-  sd->hash_keys[sd->hash_keys_cnt] = sd->hash_key;
+  rehash = (hash_rehash_t *)data;
+  for (b = rehash->from; b < rehash->to; b ++)
+  {
+    bucket = hash_store.buckets + b;
+
+    // the table grows: the index bits above the old mask are unknown, so
+    // each item is copied to all buckets it may belong to, the others fail
+    // the key check
+    if (rehash->mask <= hash_store.mask)
+    {
+      *bucket = rehash->buckets[b & rehash->mask];
+      continue;
+    }
+
+    // the table shrinks: the old buckets folded into this one are merged
+    memset(bucket, 0, sizeof(hash_bucket_t));
+    ratio = (rehash->mask + 1) / (hash_store.mask + 1);
+    for (k = 0, cnt = 0; k < ratio; k ++)
+    {
+      src = rehash->buckets + b + k * (hash_store.mask + 1);
+      for (i = 0; i < HASH_BUCKET_SIZE; i ++)
+      {
+        hash_data = src->data[i];
+        if (!hash_data.raw)
+          continue;
+
+        // the copies made when the table grew are merged back into one
+        for (j = 0; j < cnt; j ++)
+          if (bucket->keys[j] == src->keys[i] && bucket->data[j].raw == hash_data.raw)
+            break;
+        if (j < cnt)
+          continue;
+
+        // keep the most valuable items
+        if (cnt < HASH_BUCKET_SIZE)
+          r = cnt ++;
+        else
+        {
+          for (r = 0, j = 1; j < HASH_BUCKET_SIZE; j ++)
+            if (replace_value(bucket->data[j]) < replace_value(bucket->data[r]))
+              r = j;
+          if (replace_value(bucket->data[r]) >= replace_value(hash_data))
+            continue;
+        }
+
+        bucket->data[r] = hash_data;
+        bucket->keys[r] = src->keys[i];
+      }
+    }
+  }
+  return NULL;
+}
+
+static void rehash(hash_bucket_t *buckets, uint64_t mask)
+{
+  int t, thread_cnt;
+  uint64_t buckets_cnt;
+  hash_rehash_t rehash[MAX_THREADS];
+  pthread_t threads[MAX_THREADS];
+
+  buckets_cnt = hash_store.mask + 1;
+  thread_cnt = _max(_min(search_settings.max_threads, buckets_cnt >> 16), 1);
+
+  for (t = 0; t < thread_cnt; t ++)
+  {
+    rehash[t].buckets = buckets;
+    rehash[t].mask = mask;
+    rehash[t].from = buckets_cnt * t / thread_cnt;
+    rehash[t].to = buckets_cnt * (t + 1) / thread_cnt;
+    pthread_create(&threads[t], NULL, rehash_buckets, &rehash[t]);
+  }
+
+  for (t = 0; t < thread_cnt; t ++)
+    pthread_join(threads[t], NULL);
+}
+
+// the magic is written last, a process attaching to a shared segment waits
+// for it before reading the rest of the header
+static void set_hash_header(hash_file_header_t *header)
+{
+  uint64_t magic;
+
+  memset(header, 0, sizeof(hash_file_header_t));
+  header->version = HASH_FILE_VERSION;
+  header->bucket_size = sizeof(hash_bucket_t);
+  header->iter = hash_store.iter;
+  header->z_keys_seed = Z_KEYS_SEED;
+  header->z_keys_check = z_keys_check();
+  header->size = hash_store.size;
+
+  memcpy(&magic, HASH_FILE_MAGIC, sizeof(magic));
+  __atomic_store_n((uint64_t *)header->magic, magic, __ATOMIC_RELEASE);
+}
+
+static int check_hash_header(hash_file_header_t *header)
+{
+  if (memcmp(header->magic, HASH_FILE_MAGIC, sizeof(header->magic)) ||
+      header->version != HASH_FILE_VERSION ||
+      header->bucket_size != sizeof(hash_bucket_t) ||
+      header->z_keys_seed != Z_KEYS_SEED ||
+      header->z_keys_check != z_keys_check())
+    return HASH_FILE_INCOMPATIBLE;
+
+  if (header->size != hash_store.size)
+    return HASH_FILE_SIZE_MISMATCH;
+
+  return HASH_FILE_OK;
+}
+
+static int map_shared_hash()
+{
+  int i, status;
+  hash_file_header_t *header;
+
+  status = mem_alloc_shared(&hash_store.mem, hash_store.shm_name,
+                            HASH_FILE_OFFSET + hash_store.size);
+  if (status == MEM_SHARED_FAILED)
+    return HASH_SHARED_FAILED;
+
+  header = (hash_file_header_t *)hash_store.mem.ptr;
+  if (status == MEM_SHARED_CREATED)
+  {
+    set_hash_header(header);
+    __atomic_add_fetch(&header->users, 1, __ATOMIC_ACQ_REL);
+  }
+  else
+  {
+    // the process which created the segment might not have set the header yet
+    for (i = 0; i < 100 &&
+         !__atomic_load_n((uint64_t *)header->magic, __ATOMIC_ACQUIRE); i ++)
+      sleep_ms(10);
+
+    if (check_hash_header(header) != HASH_FILE_OK)
+    {
+      mem_free(&hash_store.mem);
+      return HASH_SHARED_FAILED;
+    }
+    __atomic_add_fetch(&header->users, 1, __ATOMIC_ACQ_REL);
+    hash_store.iter = header->iter & HASH_ITER_MASK;
+  }
+
+  hash_store.shm_creator = (status == MEM_SHARED_CREATED);
+  strcpy(hash_store.mapped_shm_name, hash_store.shm_name);
+  hash_store.header = header;
+  hash_store.buckets = (hash_bucket_t *)((char *)header + HASH_FILE_OFFSET);
+  return status == MEM_SHARED_CREATED ? HASH_SHARED_CREATED : HASH_SHARED_ATTACHED;
+}
+
+// the last process attached to a segment removes its name, unless the name
+// was already given to a new segment
+static void detach_shared_hash(hash_file_header_t *header, char *name)
+{
+  if (__atomic_sub_fetch(&header->users, 1, __ATOMIC_ACQ_REL) == 0 &&
+      !__atomic_load_n(&header->unlinked, __ATOMIC_ACQUIRE))
+    mem_unlink_shared(name);
+}
+
+static void alloc_hash(uint64_t buckets_cnt)
+{
+  uint64_t mask;
+  hash_bucket_t *buckets;
+  hash_file_header_t *header;
+  mem_block_t mem;
+  char mapped_shm_name[HASH_SHM_NAME_SIZE];
+
+  mem = hash_store.mem;
+  mask = hash_store.mask;
+  buckets = hash_store.buckets;
+  header = hash_store.header;
+  strcpy(mapped_shm_name, hash_store.mapped_shm_name);
+  memset(&hash_store.mem, 0, sizeof(mem_block_t));
+  hash_store.mapped_shm_name[0] = 0;
+
+  // the creator of a segment recreates it at the new size, the processes
+  // still attached to the old segment keep using it
+  if (header && hash_store.shm_creator &&
+      !strcmp(mapped_shm_name, hash_store.shm_name))
+  {
+    __atomic_store_n(&header->unlinked, 1, __ATOMIC_RELEASE);
+    mem_unlink_shared(mapped_shm_name);
+  }
+
+  hash_store.mask = buckets_cnt - 1;
+  hash_store.size = buckets_cnt * sizeof(hash_bucket_t);
+  hash_store.header = NULL;
+
+  hash_store.mode = HASH_PRIVATE;
+  if (hash_store.shm_name[0])
+    hash_store.mode = map_shared_hash();
+
+  if (hash_store.header == NULL)
+  {
+    mem_alloc(&hash_store.mem, hash_store.size);
+    hash_store.buckets = (hash_bucket_t *)hash_store.mem.ptr;
+  }
+  set_hash_numa_policy();
+
+  // the items of the existing table are preserved, unless the shared
+  // table is already in use
+  if (hash_store.mode == HASH_SHARED_ATTACHED)
+    ;
+  else if (mem.pages == PAGES_NONE)
+    clear_hash();
+  else
+    rehash(buckets, mask);
+
+  if (header)
+    detach_shared_hash(header, mapped_shm_name);
+  mem_free(&mem);
 }
 
 uint64_t init_hash(int size_in_mb)
 {
   uint64_t size, rounded_size;
 
-  size = ((uint64_t)size_in_mb << 20) / sizeof(hash_item_t);
+  size = ((uint64_t)size_in_mb << 20) / sizeof(hash_bucket_t);
   rounded_size = 1;
   while (size >>= 1)
     rounded_size <<= 1;
 
-  hash_store.mask = rounded_size - 1;
-  hash_store.size = rounded_size * sizeof(hash_item_t);
-  hash_store.items = (hash_item_t *)realloc(hash_store.items, hash_store.size);
+  if (hash_store.size != rounded_size * sizeof(hash_bucket_t))
+    alloc_hash(rounded_size);
 
   return hash_store.size;
 }
+
+// the key of the i-th test item, every bucket of the small table gets
+// HASH_BUCKET_SIZE items with distinct upper key bits
+static uint64_t test_item_key(uint64_t *state, int i, uint64_t mask)
+{
+  *state = *state * UINT64_C(6364136223846793005) + 1;
+  return ((uint64_t)(i / (mask + 1)) << 48) |
+         (*state & UINT64_C(0xffffffffffff) & ~mask) | (i & mask);
+}
+
+// a full table keeps all its items over a grow and shrink round trip, half
+// of the items are stored before the table grows, the rest after it
+int test_rehash(search_data_t *sd)
+{
+  int i, items_cnt, errors, size_in_mb;
+  uint64_t state, mask;
+  hash_data_t hash_data;
+
+  // resizing a shared table would affect the other processes
+  if (hash_store.header)
+    return 0;
+
+  size_in_mb = hash_store.size >> 20;
+  init_hash(HASH_TEST_MB);
+  clear_hash();
+  mask = hash_store.mask;
+  items_cnt = (mask + 1) * HASH_BUCKET_SIZE;
+
+  for (i = 0, state = Z_KEYS_SEED; i < items_cnt; i ++)
+  {
+    if (i == items_cnt / 2)
+      init_hash(HASH_TEST_MB * 4);
+    sd->hash_key = test_item_key(&state, i, mask);
+    set_hash_data(sd, 0, i % HASH_TEST_SCORES, 0, 1, 0, HASH_EXACT);
+  }
+
+  errors = 0;
+  init_hash(HASH_TEST_MB);
+  for (i = 0, state = Z_KEYS_SEED; i < items_cnt; i ++)
+  {
+    sd->hash_key = test_item_key(&state, i, mask);
+    hash_data = get_hash_data(sd);
+    if (!hash_data.raw || _m_score(hash_data.move) != i % HASH_TEST_SCORES)
+      errors ++;
+  }
+
+  init_hash(size_in_mb);
+  clear_hash();
+  return errors;
+}
+
+// place the table in a named shared memory segment, an empty name
+// switches back to a private table
+int set_hash_shm_name(char *name)
+{
+  hash_store.shm_name[0] = 0;
+  if (name[0] && name[0] != '/')
+    strcat(hash_store.shm_name, "/");
+  strncat(hash_store.shm_name, name, HASH_SHM_NAME_SIZE - 2);
+
+  // already attached to this segment
+  if (hash_store.header && !strcmp(hash_store.shm_name, hash_store.mapped_shm_name))
+    return hash_store.mode;
+
+  alloc_hash(hash_store.mask + 1);
+  return hash_store.mode;
+}
+
+int hash_mode()
+{
+  return hash_store.mode;
+}
+
+const char *hash_shm_name()
+{
+  return hash_store.shm_name;
+}
+
+// called on exit, the memory is left mapped for the search threads
+void release_hash()
+{
+  if (hash_store.header)
+    detach_shared_hash(hash_store.header, hash_store.mapped_shm_name);
+  hash_store.header = NULL;
+}
+
+// the table is shared by all threads, spread it over the nodes
+void set_hash_numa_policy()
+{
+  numa_interleave(&hash_store.mem);
+}
+
+const char *hash_page_size()
+{
+  return mem_page_size(&hash_store.mem);
+}
+
+int save_hash(char *file_name)
+{
+  int status;
+  FILE *f;
+  char page[HASH_FILE_OFFSET];
+
+  f = fopen(file_name, "wb");
+  if (f == NULL)
+    return HASH_FILE_IO_ERROR;
+
+  memset(page, 0, sizeof(page));
+  set_hash_header((hash_file_header_t *)page);
+
+  status = HASH_FILE_OK;
+  if (fwrite(page, sizeof(page), 1, f) != 1 ||
+      fwrite(hash_store.buckets, hash_store.size, 1, f) != 1)
+    status = HASH_FILE_IO_ERROR;
+
+  if (fclose(f))
+    status = HASH_FILE_IO_ERROR;
+  return status;
+}
+
+int load_hash(char *file_name)
+{
+  int status;
+  FILE *f;
+  hash_file_header_t header;
+
+  f = fopen(file_name, "rb");
+  if (f == NULL)
+    return HASH_FILE_IO_ERROR;
+
+  if (fread(&header, sizeof(header), 1, f) != 1)
+  {
+    fclose(f);
+    return HASH_FILE_INCOMPATIBLE;
+  }
+
+  status = check_hash_header(&header);
+  if (status != HASH_FILE_OK)
+  {
+    fclose(f);
+    return status;
+  }
+
+  if (fseek(f, HASH_FILE_OFFSET, SEEK_SET) ||
+      fread(hash_store.buckets, hash_store.size, 1, f) != 1)
+  {
+    fclose(f);
+
+    // clear_hash keeps a shared table, but its items are overwritten here
+    if (hash_store.header)
+      memset(hash_store.buckets, 0, hash_store.size);
+    else
+      clear_hash();
+    return HASH_FILE_IO_ERROR;
+  }
+
+  fclose(f);
+  hash_store.iter = header.iter & HASH_ITER_MASK;
+  if (hash_store.header)
+    hash_store.header->iter = hash_store.iter;
+  return HASH_FILE_OK;
+}
@@ -30,6 +30,22 @@ enum {
   HASH_EXACT,
 };
 
+#define HASH_SHM_NAME_SIZE  256
+
+enum {
+  HASH_PRIVATE,
+  HASH_SHARED_CREATED,
+  HASH_SHARED_ATTACHED,
+  HASH_SHARED_FAILED,
+};
+
+enum {
+  HASH_FILE_OK,
+  HASH_FILE_IO_ERROR,
+  HASH_FILE_INCOMPATIBLE,
+  HASH_FILE_SIZE_MISMATCH,
+};
+
 enum {
   Z_KEYS_EP_FLAG = (EMPTY + 1),
   Z_KEYS_MAX_INDEX,
@@ -54,11 +70,24 @@ _Static_assert(sizeof(hash_data_t) == 8, "hash_data_t size error");
 
 extern shared_z_keys_t shared_z_keys;
 
+void init_z_keys();
+void set_hash_keys(search_data_t *);
 int adjust_hash_score(int, int);
+void prefetch_hash_data(uint64_t);
 hash_data_t get_hash_data(search_data_t *);
 void set_hash_data(search_data_t *, move_t, int, int, int, int, int);
+int hash_full();
 void set_hash_iteration();
-void reset_hash_key(search_data_t *);
+void clear_hash();
 uint64_t init_hash(int);
+int test_rehash(search_data_t *);
+int set_hash_shm_name(char *);
+int hash_mode();
+const char *hash_shm_name();
+void release_hash();
+void set_hash_numa_policy();
+const char *hash_page_size();
+int save_hash(char *);
+int load_hash(char *);
 
 #endif
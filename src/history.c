@@ -37,7 +37,7 @@ void set_counter_move(search_data_t *sd, move_t move)
 
   if (!_is_m(sd->pos->move)) return;
   m_to = _m_to(sd->pos->move);
-  sd->counter_moves[sd->pos->board[m_to]][m_to] = move;
+  sd->counter_moves[_h_piece(sd->pos->board[m_to])][m_to] = move;
 }
 
 move_t get_counter_move(search_data_t *sd)
@@ -46,7 +46,7 @@ move_t get_counter_move(search_data_t *sd)
 
   if (!_is_m(sd->pos->move)) return 0;
   m_to = _m_to(sd->pos->move);
-  return sd->counter_moves[sd->pos->board[m_to]][m_to];
+  return sd->counter_moves[_h_piece(sd->pos->board[m_to])][m_to];
 }
 
 void add_to_history(search_data_t *sd, int16_t **cmh_ptr, move_t move, int score)
@@ -56,7 +56,7 @@ void add_to_history(search_data_t *sd, int16_t **cmh_ptr, move_t move, int score
 
   m_to = _m_to(move);
   m_from = _m_from(move);
-  piece_pos = sd->pos->board[m_from] * BOARD_SIZE + m_to;
+  piece_pos = _h_piece(sd->pos->board[m_from]) * BOARD_SIZE + m_to;
 
   item = &sd->history[sd->pos->side][m_from][m_to];
   *item += score - (*item) * _abs(score) / MAX_HISTORY_SCORE;
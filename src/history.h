@@ -39,7 +39,7 @@ static inline void set_counter_move_history_pointer
     if (ply > i && pos->move)
     {
       m_to = _m_to(pos->move);
-      cmh_ptr[i] = sd->counter_move_history[pos->board[m_to]][m_to];
+      cmh_ptr[i] = sd->counter_move_history[_h_piece(pos->board[m_to])][m_to];
     }
     else
       cmh_ptr[i] = NULL;
@@ -57,7 +57,7 @@ static inline int get_h_score(search_data_t *sd, position_t *pos,
 
   if (cmh_ptr)
   {
-    piece_pos = pos->board[m_from] * BOARD_SIZE + m_to;
+    piece_pos = _h_piece(pos->board[m_from]) * BOARD_SIZE + m_to;
     for (i = 0; i < MAX_CMH_PLY; i ++)
       if (cmh_ptr[i])
         score += cmh_ptr[i][piece_pos];
@@ -22,6 +22,7 @@
 #include "game.h"
 #include "hash.h"
 #include "make.h"
+#include "numa.h"
 #include "pawn_eval.h"
 #include "perft.h"
 #include "position.h"
@@ -36,6 +37,8 @@ int main(int argc, char **argv)
   init_distance();
   init_pst();
   init_lmr();
+  init_z_keys();
+  init_numa();
 
   uci();
 
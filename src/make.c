@@ -19,6 +19,8 @@
 #include "eval.h"
 #include "hash.h"
 #include "move.h"
+#include "material.h"
+#include "phash.h"
 #include "tables.h"
 #include "search.h"
 
@@ -53,6 +55,11 @@ static inline void set_piece(position_t *pos, uint64_t *hash_key, int piece, int
   pos->board[sq] = piece;
   _update_position_hash_key(pos, *hash_key, piece, sq);
 
+  if (old_piece != EMPTY)
+    pos->material_key -= _material_key(old_piece);
+  if (piece != EMPTY)
+    pos->material_key += _material_key(piece);
+
   b = _b(sq);
   if (piece == EMPTY)
   {
@@ -153,7 +160,7 @@ void make_move(search_data_t *sd, move_t move)
 
     score_mid += pst_mid[target_piece][m_to];
     score_end += pst_end[target_piece][m_to];
-    pos->phase += piece_phase[w_target_piece];
+    pos->material_key -= _material_key(target_piece);
 
     _update_position_hash_key(pos, hash_key, target_piece, m_to);
     pos->c_flag &= rook_c_flag_mask[m_to];
@@ -234,6 +241,15 @@ void make_move(search_data_t *sd, move_t move)
   sd->hash_key = hash_key;
   sd->hash_keys[++ sd->hash_keys_cnt] = hash_key;
 
+  // load hash entries while the rest of the move is made
+  prefetch_hash_data(hash_key);
+  _stat_inc(sd, prefetches);
+  if (pos->phash_key != (pos - 1)->phash_key)
+  {
+    prefetch_phash_data(sd->phash_items, pos->phash_key);
+    _stat_inc(sd, prefetches);
+  }
+
   pos->side ^= 1;
   set_pins_and_checks(pos);
 }
@@ -0,0 +1,69 @@
+/*
+  Xiphos, a UCI chess engine
+  Copyright (C) 2018, 2019 Milos Tatarevic
+
+  Xiphos is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Xiphos is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "material.h"
+#include "tables.h"
+
+// each search thread owns a table, the entries depend only on the piece counts
+material_item_t *get_material_data(material_item_t *items, uint64_t key)
+{
+  int side, piece, cnt, phase, pieces_cnt, score_mid, score_end;
+  material_item_t *item;
+
+  item = items + ((key * UINT64_C(0x9e3779b97f4a7c15)) >> (64 - MATERIAL_HASH_BITS));
+  if (item->key == key)
+    return item;
+
+  phase = 16 * piece_phase[PAWN]   + 4 * piece_phase[KNIGHT] +
+           4 * piece_phase[BISHOP] + 4 * piece_phase[ROOK] +
+           2 * piece_phase[QUEEN];
+
+  pieces_cnt = score_mid = score_end = 0;
+  for (side = WHITE; side < N_SIDES; side ++)
+  {
+    for (piece = PAWN; piece < KING; piece ++)
+    {
+      cnt = _material_cnt(key, piece | (side << SIDE_SHIFT));
+      phase -= cnt * piece_phase[piece];
+      if (piece != PAWN)
+        pieces_cnt += cnt;
+    }
+
+    // bishop pair bonus
+    if (_material_cnt(key, BISHOP | (side << SIDE_SHIFT)) >= 2)
+    {
+      score_mid += bishop_pair[PHASE_MID];
+      score_end += bishop_pair[PHASE_END];
+    }
+
+    score_mid = -score_mid;
+    score_end = -score_end;
+  }
+
+  // the material part of the initiative, the pawn placement is scored by eval
+  item->key = key;
+  item->score_mid = score_mid;
+  item->score_end = score_end;
+  item->initiative =
+    initiative[0] * (_material_cnt(key, PAWN) + _material_cnt(key, PAWN | CHANGE_SIDE)) +
+    initiative[2] * (pieces_cnt == 0) -
+    initiative[3];
+  item->phase = _max(phase, 0);
+
+  return item;
+}
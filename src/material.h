@@ -0,0 +1,40 @@
+/*
+  Xiphos, a UCI chess engine
+  Copyright (C) 2018, 2019 Milos Tatarevic
+
+  Xiphos is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Xiphos is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include "game.h"
+
+#define MATERIAL_HASH_BITS      13
+#define MATERIAL_HASH_SIZE      (1 << MATERIAL_HASH_BITS)
+
+// piece counts packed in nibbles, updated incrementally by make_move
+#define _material_key(piece)    (UINT64_C(1) << ((piece) << 2))
+#define _material_cnt(key, piece) \
+                                (((key) >> ((piece) << 2)) & 0xf)
+
+typedef struct {
+  uint64_t key;
+  int16_t score_mid, score_end, initiative;
+  uint8_t phase;
+} material_item_t;
+
+material_item_t *get_material_data(material_item_t *, uint64_t);
+
+#endif
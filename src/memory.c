@@ -0,0 +1,228 @@
+/*
+  Xiphos, a UCI chess engine
+  Copyright (C) 2018, 2019 Milos Tatarevic
+
+  Xiphos is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Xiphos is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __linux__
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include "game.h"
+#include "memory.h"
+
+#define CACHE_LINE_SIZE       64
+#define PAGE_SIZE             4096
+#define HUGE_PAGE_SIZE        (1 << 21)
+#define MIN_CLEAR_SLICE_SIZE  (1 << 24)
+
+typedef struct {
+  char *ptr;
+  uint64_t size;
+} mem_slice_t;
+
+#ifdef __linux__
+static int transparent_pages_enabled()
+{
+  int enabled;
+  FILE *f;
+  char buf[64];
+
+  f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+  if (f == NULL)
+    return 0;
+
+  enabled = fgets(buf, sizeof(buf), f) && !strstr(buf, "[never]");
+  fclose(f);
+  return enabled;
+}
+
+static int mem_map(mem_block_t *mem, uint64_t size)
+{
+  void *base;
+  uint64_t mapped_size;
+
+  // explicit huge pages, only available if reserved (vm.nr_hugepages)
+  mapped_size = _align(size, HUGE_PAGE_SIZE);
+  base = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE,
+              MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (base != MAP_FAILED)
+  {
+    mem->pages = PAGES_HUGE;
+  }
+  else
+  {
+    // transparent huge pages require the mapping to be aligned to 2MB
+    mapped_size += HUGE_PAGE_SIZE;
+    base = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+      return 0;
+
+    mem->pages = PAGES_DEFAULT;
+    if (size >= HUGE_PAGE_SIZE && transparent_pages_enabled() &&
+        !madvise((void *)_align(base, HUGE_PAGE_SIZE), size, MADV_HUGEPAGE))
+      mem->pages = PAGES_TRANSPARENT;
+  }
+
+  mem->base = base;
+  mem->ptr = (void *)_align(base, HUGE_PAGE_SIZE);
+  mem->size = size;
+  mem->mapped_size = mapped_size;
+  mem->page_size = (mem->pages == PAGES_DEFAULT) ? PAGE_SIZE : HUGE_PAGE_SIZE;
+  return 1;
+}
+#endif
+
+void mem_alloc(mem_block_t *mem, uint64_t size)
+{
+  mem_free(mem);
+
+#ifdef __linux__
+  if (mem_map(mem, size))
+    return;
+#endif
+
+  mem->base = malloc(size + CACHE_LINE_SIZE);
+  mem->ptr = (void *)_align(mem->base, CACHE_LINE_SIZE);
+  mem->size = size;
+  mem->mapped_size = mem->page_size = 0;
+  mem->pages = PAGES_DEFAULT;
+}
+
+// map a named POSIX shared memory segment, the segment is created if it
+// doesn't exist, and it is kept until it is unlinked
+int mem_alloc_shared(mem_block_t *mem, char *name, uint64_t size)
+{
+  mem_free(mem);
+
+#ifdef __linux__
+  int fd, status;
+  void *base;
+  struct stat st;
+
+  status = MEM_SHARED_CREATED;
+  fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0)
+  {
+    status = MEM_SHARED_ATTACHED;
+    fd = shm_open(name, O_RDWR, 0600);
+  }
+  if (fd < 0)
+    return MEM_SHARED_FAILED;
+
+  if (status == MEM_SHARED_CREATED && ftruncate(fd, size))
+  {
+    close(fd);
+    shm_unlink(name);
+    return MEM_SHARED_FAILED;
+  }
+
+  if (fstat(fd, &st) || st.st_size != size)
+  {
+    close(fd);
+    return MEM_SHARED_FAILED;
+  }
+
+  base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED)
+    return MEM_SHARED_FAILED;
+
+  mem->base = mem->ptr = base;
+  mem->size = mem->mapped_size = size;
+  mem->page_size = PAGE_SIZE;
+  mem->pages = PAGES_DEFAULT;
+  return status;
+#else
+  return MEM_SHARED_FAILED;
+#endif
+}
+
+void mem_unlink_shared(char *name)
+{
+#ifdef __linux__
+  shm_unlink(name);
+#endif
+}
+
+void mem_free(mem_block_t *mem)
+{
+  if (mem->pages == PAGES_NONE)
+    return;
+
+#ifdef __linux__
+  if (mem->mapped_size)
+    munmap(mem->base, mem->mapped_size);
+  else
+#endif
+    free(mem->base);
+
+  memset(mem, 0, sizeof(mem_block_t));
+}
+
+static void *clear_slice(void *data)
+{
+  mem_slice_t *slice;
+
+  slice = (mem_slice_t *)data;
+  memset(slice->ptr, 0, slice->size);
+  return NULL;
+}
+
+// clear the block in parallel, each thread touches its own set of pages
+void mem_clear(mem_block_t *mem, int thread_cnt)
+{
+  int t;
+  uint64_t start, end;
+  mem_slice_t slices[MAX_THREADS];
+  pthread_t threads[MAX_THREADS];
+
+  thread_cnt = _min(thread_cnt, mem->size / MIN_CLEAR_SLICE_SIZE);
+  thread_cnt = _max(_min(thread_cnt, MAX_THREADS), 1);
+
+  for (t = 0, start = 0; t < thread_cnt; t ++, start = end)
+  {
+    end = _min(_align(mem->size * (t + 1) / thread_cnt, HUGE_PAGE_SIZE), mem->size);
+    slices[t].ptr = (char *)mem->ptr + start;
+    slices[t].size = end - start;
+
+    pthread_create(&threads[t], NULL, clear_slice, &slices[t]);
+  }
+
+  for (t = 0; t < thread_cnt; t ++)
+    pthread_join(threads[t], NULL);
+}
+
+const char *mem_page_size(mem_block_t *mem)
+{
+  switch (mem->pages)
+  {
+    case PAGES_HUGE:
+      return "2MB";
+    case PAGES_TRANSPARENT:
+      return "2MB (transparent)";
+    case PAGES_DEFAULT:
+      return "4KB";
+  }
+  return "none";
+}
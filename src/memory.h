@@ -0,0 +1,53 @@
+/*
+  Xiphos, a UCI chess engine
+  Copyright (C) 2018, 2019 Milos Tatarevic
+
+  Xiphos is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Xiphos is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <inttypes.h>
+
+#define _align(p, a)          (((uintptr_t)(p) + (a) - 1) & ~(uintptr_t)((a) - 1))
+
+enum {
+  PAGES_NONE,
+  PAGES_DEFAULT,
+  PAGES_TRANSPARENT,
+  PAGES_HUGE,
+};
+
+enum {
+  MEM_SHARED_FAILED,
+  MEM_SHARED_CREATED,
+  MEM_SHARED_ATTACHED,
+};
+
+// page_size is the page size of a mapped block, 0 for a block from malloc
+typedef struct {
+  void *ptr, *base;
+  uint64_t size, mapped_size, page_size;
+  int pages;
+} mem_block_t;
+
+void mem_alloc(mem_block_t *, uint64_t);
+int mem_alloc_shared(mem_block_t *, char *, uint64_t);
+void mem_unlink_shared(char *);
+void mem_free(mem_block_t *);
+void mem_clear(mem_block_t *, int);
+const char *mem_page_size(mem_block_t *);
+
+#endif
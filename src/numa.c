@@ -0,0 +1,196 @@
+/*
+  Xiphos, a UCI chess engine
+  Copyright (C) 2018, 2019 Milos Tatarevic
+
+  Xiphos is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Xiphos is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef __linux__
+  #define _GNU_SOURCE
+  #include <sched.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "game.h"
+#include "numa.h"
+
+#define NODE_PATH           "/sys/devices/system/node"
+
+#define MPOL_DEFAULT        0
+#define MPOL_PREFERRED      1
+#define MPOL_INTERLEAVE     3
+#define MPOL_MF_MOVE        (1 << 1)
+
+struct {
+  int enabled, nodes_cnt, node_ids[MAX_NUMA_NODES];
+#ifdef __linux__
+  cpu_set_t cpus[MAX_NUMA_NODES];
+#endif
+} numa;
+
+#ifdef __linux__
+// parse a sysfs list, e.g. "0-3,8-11", calls set(i) for each item
+static int read_list(char *path, void (*set)(int, void *), void *data)
+{
+  int i, from, to;
+  char buf[4096], *p;
+  FILE *f;
+
+  f = fopen(path, "r");
+  if (f == NULL)
+    return 0;
+
+  p = fgets(buf, sizeof(buf), f);
+  fclose(f);
+  if (p == NULL)
+    return 0;
+
+  while (*p >= '0' && *p <= '9')
+  {
+    from = to = strtol(p, &p, 10);
+    if (*p == '-')
+      to = strtol(p + 1, &p, 10);
+    for (i = from; i <= to; i ++)
+      set(i, data);
+    if (*p == ',') p ++;
+  }
+  return 1;
+}
+
+static void add_node(int node_id, void *data)
+{
+  if (node_id < MAX_NUMA_NODES)
+    numa.node_ids[numa.nodes_cnt ++] = node_id;
+}
+
+static void add_cpu(int cpu, void *data)
+{
+  if (cpu < CPU_SETSIZE)
+    CPU_SET(cpu, (cpu_set_t *)data);
+}
+
+static int bind_memory(void *ptr, uint64_t size, int mode, uint64_t node_mask)
+{
+  unsigned long mask;
+
+  mask = node_mask;
+  return syscall(SYS_mbind, ptr, size, mode, mode == MPOL_DEFAULT ? NULL : &mask,
+          sizeof(mask) * 8 + 1, mode == MPOL_DEFAULT ? 0 : MPOL_MF_MOVE);
+}
+#endif
+
+int init_numa()
+{
+  numa.nodes_cnt = 0;
+
+#ifdef __linux__
+  int n;
+  char path[256];
+
+  read_list(NODE_PATH "/online", add_node, NULL);
+  for (n = 0; n < numa.nodes_cnt; n ++)
+  {
+    CPU_ZERO(&numa.cpus[n]);
+    sprintf(path, NODE_PATH "/node%d/cpulist", numa.node_ids[n]);
+    if (!read_list(path, add_cpu, &numa.cpus[n]) || !CPU_COUNT(&numa.cpus[n]))
+      numa.nodes_cnt = 0;
+  }
+#endif
+
+  if (numa.nodes_cnt == 0)
+  {
+    numa.nodes_cnt = 1;
+    numa.node_ids[0] = 0;
+  }
+  return numa.nodes_cnt;
+}
+
+void set_numa(int enabled)
+{
+  numa.enabled = enabled;
+}
+
+int numa_enabled()
+{
+  return numa.enabled;
+}
+
+int numa_nodes()
+{
+  return numa.nodes_cnt;
+}
+
+// threads are distributed over the nodes in a round-robin fashion
+void numa_bind_thread(int tid)
+{
+#ifdef __linux__
+  if (numa.enabled)
+    sched_setaffinity(0, sizeof(cpu_set_t), &numa.cpus[tid % numa.nodes_cnt]);
+#endif
+}
+
+void numa_interleave(mem_block_t *mem)
+{
+#ifdef __linux__
+  int n;
+  uint64_t node_mask;
+
+  if (mem->mapped_size == 0)
+    return;
+
+  node_mask = 0;
+  for (n = 0; n < numa.nodes_cnt; n ++)
+    node_mask |= UINT64_C(1) << numa.node_ids[n];
+
+  bind_memory(mem->ptr, _align(mem->size, mem->page_size),
+              numa.enabled ? MPOL_INTERLEAVE : MPOL_DEFAULT, node_mask);
+#endif
+}
+
+// place each slice on the node of the thread using it, the slice boundaries
+// are moved to the page boundaries of the mapping (mbind fails on a huge page
+// mapping otherwise, and splits transparent huge pages), a page shared by
+// two slices goes to the first one, returns 0 if the binding failed
+int numa_bind_slices(mem_block_t *mem, uint64_t slice_size)
+{
+#ifdef __linux__
+  int t, n;
+  uint64_t start, end, size;
+
+  if (mem->mapped_size == 0)
+    return 1;
+
+  size = _align(mem->size, mem->page_size);
+  if (!numa.enabled)
+    return bind_memory(mem->ptr, size, MPOL_DEFAULT, 0) == 0;
+
+  for (t = 0, start = 0; start < size; t ++)
+  {
+    end = _min(_align((t + 1) * slice_size, mem->page_size), size);
+    if (start >= end)
+      continue;
+
+    n = numa.node_ids[t % numa.nodes_cnt];
+    if (bind_memory((char *)mem->ptr + start, end - start, MPOL_PREFERRED,
+                    UINT64_C(1) << n))
+      return 0;
+    start = end;
+  }
+#endif
+  return 1;
+}
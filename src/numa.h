@@ -0,0 +1,34 @@
+/*
+  Xiphos, a UCI chess engine
+  Copyright (C) 2018, 2019 Milos Tatarevic
+
+  Xiphos is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Xiphos is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NUMA_H
+#define NUMA_H
+
+#include "memory.h"
+
+#define MAX_NUMA_NODES      64
+
+int init_numa();
+void set_numa(int);
+int numa_enabled();
+int numa_nodes();
+void numa_bind_thread(int);
+void numa_interleave(mem_block_t *);
+int numa_bind_slices(mem_block_t *, uint64_t);
+
+#endif
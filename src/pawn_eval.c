@@ -16,10 +16,13 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <string.h>
+
 #include "bitboard.h"
 #include "game.h"
 #include "phash.h"
 #include "position.h"
+#include "search.h"
 #include "tables.h"
 
 #define DISTANCE_BONUS_SHIFT    2
@@ -56,16 +59,23 @@ static inline int eval_pawn_shield(int side, int k_sq, uint64_t p_occ_f, uint64_
   return score;
 }
 
-phash_data_t pawn_eval(position_t *pos)
+phash_data_t pawn_eval(search_data_t *sd)
 {
   int m, r, f, side, sq, rsq, ssq, k_sq_f, k_sq_o, d, d_max, unopposed,
       score_mid, score_end;
   uint64_t b, pushed_passers, p_occ, p_occ_f, p_occ_o, p_occ_x;
   phash_data_t phash_data;
+  position_t *pos;
 
-  if (get_phash_data(pos, &phash_data))
+  pos = sd->pos;
+  _stat_inc(sd, phash_probes);
+  if (get_phash_data(sd->phash_items, pos, &phash_data))
+  {
+    _stat_inc(sd, phash_hits);
     return phash_data;
+  }
 
+  memset(&phash_data, 0, sizeof(phash_data));
   pushed_passers = 0;
   p_occ = pos->piece_occ[PAWN];
   score_mid = score_end = 0;
@@ -138,6 +148,13 @@ phash_data_t pawn_eval(position_t *pos)
       }
     }
 
+    // structures reused by eval
+    phash_data.pawn_attacks[side] = pawn_attacks(p_occ_f, side);
+    b = p_occ_f | (p_occ_f >> 32);
+    b |= b >> 16;
+    b |= b >> 8;
+    phash_data.semi_open_files[side] = ~b & 0xff;
+
     score_mid += eval_pawn_shield(side, k_sq_f, p_occ_f, p_occ_o);
     score_end += d_max << DISTANCE_BONUS_SHIFT;
 
@@ -145,5 +162,10 @@ phash_data_t pawn_eval(position_t *pos)
     score_end = -score_end;
   }
 
-  return set_phash_data(pos, pushed_passers, score_mid, score_end);
+  phash_data.pushed_passers = pushed_passers;
+  phash_data.score_mid = score_mid;
+  phash_data.score_end = score_end;
+  set_phash_data(sd->phash_items, pos, &phash_data);
+
+  return phash_data;
 }
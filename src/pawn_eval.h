@@ -21,8 +21,9 @@
 
 #include "phash.h"
 #include "position.h"
+#include "search.h"
 
 void init_distance();
-phash_data_t pawn_eval(position_t *);
+phash_data_t pawn_eval(search_data_t *);
 
 #endif
@@ -20,6 +20,7 @@
 #include "eval.h"
 #include "game.h"
 #include "gen.h"
+#include "hash.h"
 #include "make.h"
 #include "move_eval.h"
 #include "search.h"
@@ -185,6 +186,14 @@ void run_tests()
     else
       _p(".");
   }
+
+  if (test_rehash(sd))
+  {
+    _p("E");
+    errors ++;
+  }
+  else
+    _p(".");
   _p("\nerrors: %d\n", errors);
 
   free(sd);
@@ -22,17 +22,26 @@
 #include "game.h"
 #include "position.h"
 
+#define PHASH_SIZE    (1 << 16)
+
 typedef union {
   struct {
     int16_t score_mid;
     int16_t score_end;
+    uint8_t semi_open_files[N_SIDES];
     uint64_t pushed_passers;
+    uint64_t pawn_attacks[N_SIDES];
   };
-  uint64_t raw[2];
+  uint64_t raw[4];
 } phash_data_t;
 
-int get_phash_data(position_t *, phash_data_t *);
-phash_data_t set_phash_data(position_t *, uint64_t, int, int);
-void init_phash(int);
+typedef struct {
+  uint64_t mask;
+  phash_data_t data;
+} phash_item_t;
+
+void prefetch_phash_data(phash_item_t *, uint64_t);
+int get_phash_data(phash_item_t *, position_t *, phash_data_t *);
+void set_phash_data(phash_item_t *, position_t *, phash_data_t *);
 
 #endif
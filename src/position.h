@@ -37,7 +37,6 @@ typedef struct {
            in_check,
            see_pins,
            fifty_cnt,
-           phase,
            k_sq[N_SIDES];
   int16_t  score_mid,
            score_end,
@@ -48,6 +47,7 @@ typedef struct {
            pinned[N_SIDES],
            pinners[N_SIDES];
   move_t   move;
+  uint64_t material_key;
   uint8_t  board[BOARD_SIZE];
 } __attribute__ ((aligned (16))) position_t;
 _Static_assert(sizeof(position_t) == 192, "position_t size error");
@@ -59,7 +59,6 @@ int SEE(position_t *, move_t, int);
 
 int insufficient_material(position_t *);
 int non_pawn_material(position_t *);
-void set_phase(position_t *);
 void reevaluate_position(position_t *);
 
 static inline void position_cpy(position_t *dest, position_t *src)
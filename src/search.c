@@ -18,13 +18,16 @@
 
 #include <math.h>
 #include <string.h>
+#include <time.h>
 
 #include "eval.h"
+#include "gen.h"
 #include "hash.h"
 #include "history.h"
 #include "game.h"
 #include "make.h"
 #include "move_list.h"
+#include "numa.h"
 #include "position.h"
 #include "search.h"
 #include "tablebases.h"
@@ -41,12 +44,18 @@
 #define SE_DEPTH                      8
 #define MIN_DEPTH_TO_REACH            4
 #define START_ASPIRATION_DEPTH        4
+#define ABDADA_DEPTH                  3
 
 #define RAZOR_MARGIN                  200
 #define PROBCUT_MARGIN                80
 #define INIT_ASPIRATION_WINDOW        6
 #define MIN_HASH_DEPTH                -2
 
+#define NODES_BATCH                   1024
+
+#define ABDADA_SIZE                   (1 << 13)
+#define ABDADA_WAYS                   4
+
 #define _futility_margin(depth)       (80 * (depth))
 #define _see_quiets_margin(depth)     (-15 * _sqr((depth) - 1))
 #define _see_captures_margin(depth)   (-100 * (depth))
@@ -62,7 +71,20 @@ const int lmp[][LMP_DEPTH + 1] = {
 
 int lmr[MAX_DEPTH][MAX_MOVES];
 int shared_search_depth_cnt[MAX_DEPTH];
-move_t pv[PLY_LIMIT * PLY_LIMIT];
+
+// moves currently searched by any thread, used by ABDADA
+uint64_t searching_moves[ABDADA_SIZE][ABDADA_WAYS];
+
+// the search threads are parked between the searches
+struct {
+  pthread_t threads[MAX_THREADS], supervisor;
+  pthread_cond_t start_cond, idle_cond;
+  int threads_cnt, running, searching, go, exit, supervisor_started;
+  uint64_t generation, start_generation;
+} thread_pool = {
+  .start_cond = PTHREAD_COND_INITIALIZER,
+  .idle_cond = PTHREAD_COND_INITIALIZER,
+};
 
 void init_lmr()
 {
@@ -90,17 +112,114 @@ static inline int draw(search_data_t *sd)
   return 0;
 }
 
-void update_pv(move_t move, int ply)
+void update_pv(search_data_t *sd, move_t move, int ply)
 {
   move_t *dest, *src;
 
-  dest = pv + ply * PLY_LIMIT;
+  dest = sd->pv + ply * PLY_LIMIT;
   src = dest + PLY_LIMIT;
 
   *dest++ = move;
   while ((*dest++ = *src++));
 }
 
+static inline uint64_t move_key(search_data_t *sd, move_t move)
+{
+  return sd->hash_key ^ (_m_base(move) * UINT64_C(0x9e3779b97f4a7c15));
+}
+
+static inline int searched_by_other_thread(uint64_t key)
+{
+  int i;
+  uint64_t *entry;
+
+  entry = searching_moves[key & (ABDADA_SIZE - 1)];
+  for (i = 0; i < ABDADA_WAYS; i ++)
+    if (__atomic_load_n(&entry[i], __ATOMIC_RELAXED) == key)
+      return 1;
+  return 0;
+}
+
+// the markers are only hints, a lost update just searches a move twice
+static inline void set_searching_move(uint64_t key)
+{
+  int i;
+  uint64_t *entry;
+
+  entry = searching_moves[key & (ABDADA_SIZE - 1)];
+  for (i = 0; i < ABDADA_WAYS; i ++)
+    if (__atomic_load_n(&entry[i], __ATOMIC_RELAXED) == 0)
+    {
+      __atomic_store_n(&entry[i], key, __ATOMIC_RELAXED);
+      return;
+    }
+}
+
+static inline void clear_searching_move(uint64_t key)
+{
+  int i;
+  uint64_t *entry;
+
+  entry = searching_moves[key & (ABDADA_SIZE - 1)];
+  for (i = 0; i < ABDADA_WAYS; i ++)
+    if (__atomic_load_n(&entry[i], __ATOMIC_RELAXED) == key)
+    {
+      __atomic_store_n(&entry[i], 0, __ATOMIC_RELAXED);
+      return;
+    }
+}
+
+// MultiPV: the best moves of the previous lines are kept at the front of
+// the root move list and skipped
+static inline move_t next_root_move(search_data_t *sd, int *root_i)
+{
+  return *root_i < sd->root_moves_cnt ? sd->root_moves[(*root_i) ++].move : 0;
+}
+
+static inline void update_root_move(search_data_t *sd, move_t move, int score,
+                                    uint64_t nodes)
+{
+  int i;
+
+  for (i = sd->pv_idx; i < sd->root_moves_cnt; i ++)
+    if (_m_eq(move, sd->root_moves[i].move))
+    {
+      sd->root_moves[i].score = score;
+      sd->root_moves[i].nodes += nodes;
+      return;
+    }
+}
+
+// the next node count at which a thread adds its nodes to the shared counter,
+// the batches get smaller close to the limit
+static inline void set_nodes_sync(search_data_t *sd, uint64_t remaining_nodes)
+{
+  if (search_status.go.nodes == 0)
+    sd->nodes_sync = UINT64_MAX;
+  else
+    sd->nodes_sync = sd->nodes +
+      _max(_min(remaining_nodes / search_settings.max_threads, NODES_BATCH), 1);
+}
+
+static void sync_nodes(search_data_t *sd)
+{
+  uint64_t nodes;
+
+  nodes = __atomic_add_fetch(&search_status.nodes, sd->nodes - sd->nodes_synced,
+                             __ATOMIC_RELAXED);
+  sd->nodes_synced = sd->nodes;
+
+  if (nodes < search_status.go.nodes)
+    set_nodes_sync(sd, search_status.go.nodes - nodes);
+  else
+  {
+    // keep searching until the main thread has a move
+    if (!search_status.go.ponder && search_settings.threads_search_data[0].depth > 0)
+      search_status.done = 1;
+    set_nodes_sync(sd, 0);
+  }
+}
+
 int qsearch(search_data_t *sd, int pv_node, int alpha, int beta, int depth, int ply)
 {
   int hash_depth, hash_bound, hash_score, static_score, best_score, score;
@@ -109,12 +228,15 @@ int qsearch(search_data_t *sd, int pv_node, int alpha, int beta, int depth, int
   position_t *pos;
   move_list_t move_list;
 
+  if (sd->nodes >= sd->nodes_sync) sync_nodes(sd);
+  _stat(sd, nodes, 0);
+
   alpha = _max(alpha, -MATE_SCORE + ply);
   beta = _min(beta, MATE_SCORE - ply + 1);
   if (alpha >= beta) return alpha;
 
   pos = sd->pos;
-  if (ply >= MAX_PLY) return eval(pos);
+  if (ply >= MAX_PLY) return eval(sd);
   if (draw(sd)) return 0;
 
   hash_move = 0;
@@ -134,7 +256,10 @@ int qsearch(search_data_t *sd, int pv_node, int alpha, int beta, int depth, int
       if ((hash_bound == HASH_LOWER_BOUND && hash_score >= beta) ||
           (hash_bound == HASH_UPPER_BOUND && hash_score <= alpha) ||
           (hash_bound == HASH_EXACT))
+      {
+        sd->hash_stats.cutoffs ++;
         return hash_score;
+      }
     }
   }
 
@@ -144,7 +269,7 @@ int qsearch(search_data_t *sd, int pv_node, int alpha, int beta, int depth, int
   }
   else
   {
-    best_score = static_score = hash_data.raw ? hash_data.static_score : eval(pos);
+    best_score = static_score = hash_data.raw ? hash_data.static_score : eval(sd);
     if (hash_data.raw)
     {
       if ((hash_bound == HASH_LOWER_BOUND && hash_score > static_score) ||
@@ -198,14 +323,16 @@ int pvs(search_data_t *sd, int root_node, int pv_node, int alpha, int beta,
 {
   int i, searched_cnt, quiet_moves_cnt, lmp_cnt, best_score, static_score,
       score, use_hash, hash_bound, hash_score, improving, beta_cut,
-      new_depth, piece_pos, reduction, h_score, piece_cnt;
+      new_depth, piece_pos, reduction, h_score, piece_cnt, abdada,
+      deferred_cnt, deferred_i, root_i;
   unsigned tb_result;
+  uint64_t searching_key, nodes;
   move_t move, best_move, hash_move;
   hash_data_t hash_data;
   int16_t *cmh_ptr[MAX_CMH_PLY];
   position_t *pos;
   move_list_t move_list;
-  move_t quiet_moves[MAX_MOVES];
+  move_t quiet_moves[MAX_MOVES], deferred_moves[MAX_MOVES];
 
   if (depth <= 0)
     return qsearch(sd, pv_node, alpha, beta, 0, ply);
@@ -215,9 +342,11 @@ int pvs(search_data_t *sd, int root_node, int pv_node, int alpha, int beta,
   if (alpha >= beta) return alpha;
 
   pos = sd->pos;
-  if (ply >= MAX_PLY) return eval(pos);
+  if (ply >= MAX_PLY) return eval(sd);
 
+  if (sd->nodes >= sd->nodes_sync) sync_nodes(sd);
   if (search_status.done) return 0;
+  _stat(sd, nodes, depth);
   if (!root_node && draw(sd)) return 0;
 
   set_counter_move_history_pointer(cmh_ptr, sd, ply);
@@ -253,6 +382,8 @@ int pvs(search_data_t *sd, int root_node, int pv_node, int alpha, int beta,
             else if (hash_bound == HASH_UPPER_BOUND)
               add_to_history(sd, cmh_ptr, hash_move, -_h_score(depth));
           }
+          sd->hash_stats.cutoffs ++;
+          _stat(sd, tt_cutoffs, depth);
           return hash_score;
         }
     }
@@ -307,7 +438,7 @@ int pvs(search_data_t *sd, int root_node, int pv_node, int alpha, int beta,
       static_score = hash_data.static_score;
     else
     {
-      static_score = eval(pos);
+      static_score = eval(sd);
       if (use_hash)
         set_hash_data(sd, 0, 0, static_score, MIN_HASH_DEPTH, ply, HASH_BOUND_NOT_USED);
     }
@@ -332,19 +463,27 @@ int pvs(search_data_t *sd, int root_node, int pv_node, int alpha, int beta,
       if (depth <= RAZOR_DEPTH && best_score + RAZOR_MARGIN < beta)
       {
         score = qsearch(sd, 0, alpha, beta, 0, ply);
-        if (score < beta) return score;
+        if (score < beta)
+        {
+          _stat(sd, razor_cutoffs, depth);
+          return score;
+        }
       }
 
       if (non_pawn_material(pos))
       {
         // futility
         if (depth <= FUTILITY_DEPTH && best_score >= beta + _futility_margin(depth))
+        {
+          _stat(sd, futility_cutoffs, depth);
           return best_score;
+        }
 
         // null move
         if (depth >= 2 && best_score >= beta)
         {
           reduction = (depth) / 4 + 3 + _min((best_score - beta) / 80, 3);
+          _stat(sd, null_tries, depth);
 
           make_null_move(sd);
           score = -pvs(sd, 0, 0, -beta, -beta + 1, depth - reduction, ply + 1, 0, 0);
@@ -352,7 +491,10 @@ int pvs(search_data_t *sd, int root_node, int pv_node, int alpha, int beta,
 
           if (search_status.done) return 0;
           if (score >= beta)
+          {
+            _stat(sd, null_cutoffs, depth);
             return _is_mate_score(score) ? beta : score;
+          }
         }
       }
 
@@ -378,7 +520,10 @@ int pvs(search_data_t *sd, int root_node, int pv_node, int alpha, int beta,
           undo_move(sd);
 
           if (score >= beta_cut)
+          {
+            _stat(sd, probcut_cutoffs, depth);
             return score;
+          }
         }
       }
     }
@@ -402,22 +547,31 @@ int pvs(search_data_t *sd, int root_node, int pv_node, int alpha, int beta,
   best_score = -MATE_SCORE + ply;
   best_move = hash_move;
   searched_cnt = quiet_moves_cnt = lmp_cnt = 0;
+  deferred_cnt = deferred_i = 0;
+  abdada = search_settings.abdada && search_settings.max_threads > 1 &&
+           depth >= ABDADA_DEPTH;
+  searching_key = 0;
 
   sd->killer_moves[ply + 1][0] = sd->killer_moves[ply + 1][1] = 0;
 
-  while ((move = next_move(&move_list, sd, hash_move, depth, ply)))
+  // the moves deferred by ABDADA are searched after the other moves
+  root_i = sd->pv_idx;
+  while ((move = root_node ? next_root_move(sd, &root_i) :
+                             next_move(&move_list, sd, hash_move, depth, ply)) ||
+         (deferred_i < deferred_cnt && (move = deferred_moves[deferred_i ++])))
   {
     if (_m_eq(move, skip_move))
       continue;
 
     lmp_cnt ++;
-    if (!root_node && searched_cnt >= 1)
+    if (!root_node && searched_cnt >= 1 && !deferred_i)
     {
       if (_m_is_quiet(move))
       {
         // LMP
         if (depth <= LMP_DEPTH && lmp_cnt > lmp[improving][depth])
         {
+          _stat(sd, lmp_prunes, depth);
           move_list.cnt = move_list.moves_cnt;
           continue;
         }
@@ -425,21 +579,30 @@ int pvs(search_data_t *sd, int root_node, int pv_node, int alpha, int beta,
         // CMH pruning
         if (depth <= CMHP_DEPTH)
         {
-          piece_pos = pos->board[_m_from(move)] * BOARD_SIZE + _m_to(move);
+          piece_pos = _h_piece(pos->board[_m_from(move)]) * BOARD_SIZE + _m_to(move);
           if ((!cmh_ptr[0] || cmh_ptr[0][piece_pos] < 0) &&
               (!cmh_ptr[1] || cmh_ptr[1][piece_pos] < 0))
+          {
+            _stat(sd, cmh_prunes, depth);
             continue;
+          }
         }
 
         // SEE pruning
         if (SEE(pos, move, 1) < _see_quiets_margin(depth))
+        {
+          _stat(sd, see_prunes, depth);
           continue;
+        }
       }
 
       // prune bad captures
       if (move_list.phase == BAD_CAPTURES &&
           _m_score(move) < _see_captures_margin(depth))
+      {
+        _stat(sd, see_prunes, depth);
         continue;
+      }
     }
 
     if (!legal_move(pos, move))
@@ -448,6 +611,18 @@ int pvs(search_data_t *sd, int root_node, int pv_node, int alpha, int beta,
       continue;
     }
 
+    // leave the moves searched by other threads for later
+    if (abdada && searched_cnt >= 1)
+    {
+      searching_key = move_key(sd, move);
+      if (!deferred_i && searched_by_other_thread(searching_key))
+      {
+        deferred_moves[deferred_cnt ++] = move;
+        continue;
+      }
+      set_searching_move(searching_key);
+    }
+
     new_depth = depth - 1;
 
     // singular extensions
@@ -458,12 +633,15 @@ int pvs(search_data_t *sd, int root_node, int pv_node, int alpha, int beta,
       beta_cut = hash_score - depth;
       score = pvs(sd, 0, 0, beta_cut - 1, beta_cut, depth >> 1, ply, 0, move);
       if (score < beta_cut)
+      {
+        _stat(sd, singular_extensions, depth);
         new_depth ++;
+      }
     }
     // cmh extension
     else if (_m_is_quiet(move))
     {
-      piece_pos = pos->board[_m_from(move)] * BOARD_SIZE + _m_to(move);
+      piece_pos = _h_piece(pos->board[_m_from(move)]) * BOARD_SIZE + _m_to(move);
       if (cmh_ptr[0] && cmh_ptr[1] &&
           cmh_ptr[0][piece_pos] >= MAX_HISTORY_SCORE / 2 &&
           cmh_ptr[1][piece_pos] >= MAX_HISTORY_SCORE / 2)
@@ -471,11 +649,12 @@ int pvs(search_data_t *sd, int root_node, int pv_node, int alpha, int beta,
     }
 
     // make move
+    nodes = sd->nodes;
     make_move(sd, move);
     searched_cnt ++;
 
-    if (sd->tid == 0 && pv_node)
-      pv[(ply + 1) * PLY_LIMIT] = 0;
+    if (pv_node)
+      sd->pv[(ply + 1) * PLY_LIMIT] = 0;
 
     // search
     if (searched_cnt == 1)
@@ -501,16 +680,26 @@ int pvs(search_data_t *sd, int root_node, int pv_node, int alpha, int beta,
 
       score = -pvs(sd, 0, 0, -alpha - 1, -alpha, new_depth - reduction, ply + 1, 1, 0);
       if (reduction && score > alpha)
+      {
+        _stat(sd, lmr_researches, depth);
         score = -pvs(sd, 0, 0, -alpha - 1, -alpha, new_depth, ply + 1, 1, 0);
+      }
 
       if (score > alpha && score < beta)
         score = -pvs(sd, 0, 1, -beta, -alpha, new_depth, ply + 1, 1, 0);
     }
     undo_move(sd);
 
+    if (abdada && searched_cnt > 1)
+      clear_searching_move(searching_key);
+
     if (search_status.done)
       return 0;
 
+    // the moves failing low keep their upper bound as score
+    if (root_node)
+      update_root_move(sd, move, score, sd->nodes - nodes);
+
     if (score > best_score)
     {
       best_score = score;
@@ -518,22 +707,25 @@ int pvs(search_data_t *sd, int root_node, int pv_node, int alpha, int beta,
       {
         best_move = move;
 
-        if (sd->tid == 0 && pv_node)
+        if (pv_node)
         {
-          if (root_node)
+          if (root_node && sd->pv_idx == 0)
           {
-            if (_m_eq(best_move, pv[0]))
+            if (sd->tid == 0)
             {
-              if (search_status.tm_steps > 0)
-                search_status.tm_steps --;
+              if (_m_eq(best_move, sd->pv[0]))
+              {
+                if (search_status.tm_steps > 0)
+                  search_status.tm_steps --;
+              }
+              else
+                search_status.tm_steps = TM_STEPS - 1;
             }
-            else
-              search_status.tm_steps = TM_STEPS - 1;
 
-            search_status.score = score;
-            search_status.depth = depth;
+            sd->score = score;
+            sd->depth = depth;
           }
-          update_pv(move, ply);
+          update_pv(sd, move, ply);
         }
 
         alpha = score;
@@ -541,6 +733,9 @@ int pvs(search_data_t *sd, int root_node, int pv_node, int alpha, int beta,
 
         if (alpha >= beta) {
           hash_bound = HASH_LOWER_BOUND;
+          _stat(sd, fail_highs, depth);
+          if (searched_cnt == 1)
+            _stat(sd, first_fail_highs, depth);
 
           // save history / killer / counter moves
           if (_m_is_quiet(best_move))
@@ -574,50 +769,120 @@ int pvs(search_data_t *sd, int root_node, int pv_node, int alpha, int beta,
   return best_score;
 }
 
-void *search_thread(void *thread_data)
+// the best moves first, the subtree size only breaks ties, the sort is stable
+static void sort_root_moves(root_move_t *root_moves, int root_moves_cnt)
 {
-  int depth, search_depth_cnt, score, prev_score, alpha, beta, delta;
-  uint64_t target_time;
-  search_data_t *sd;
+  int i, j;
+  root_move_t root_move;
 
-  sd = (search_data_t *)thread_data;
+  for (i = 1; i < root_moves_cnt; i ++)
+  {
+    root_move = root_moves[i];
+    for (j = i; j > 0 &&
+         (root_moves[j - 1].score < root_move.score ||
+          (root_moves[j - 1].score == root_move.score &&
+           root_moves[j - 1].nodes < root_move.nodes)); j --)
+      root_moves[j] = root_moves[j - 1];
+    root_moves[j] = root_move;
+  }
+}
+
+static void sort_pv_lines(pv_line_t *lines, int lines_cnt)
+{
+  int i, j;
+  pv_line_t line;
+
+  for (i = 1; i < lines_cnt; i ++)
+  {
+    line = lines[i];
+    for (j = i; j > 0 && lines[j - 1].score < line.score; j --)
+      lines[j] = lines[j - 1];
+    lines[j] = line;
+  }
+}
+
+void search_thread(search_data_t *sd)
+{
+  int i, depth, search_depth_cnt, score, prev_score, alpha, beta, delta;
+  uint64_t target_time;
+  pv_line_t *line;
 
   score = prev_score = 0;
   for (depth = 1; depth <= search_status.max_depth; depth ++)
   {
-    pthread_mutex_lock(&search_settings.mutex);
-    search_depth_cnt = ++shared_search_depth_cnt[depth];
-    pthread_mutex_unlock(&search_settings.mutex);
-
-    if (sd->tid && depth > 1 && depth < search_status.max_depth &&
+    // helper threads skip the depths already searched by enough threads
+    search_depth_cnt =
+      __atomic_add_fetch(&shared_search_depth_cnt[depth], 1, __ATOMIC_RELAXED);
+    if (!search_settings.abdada &&
+        sd->tid && depth > 1 && depth < search_status.max_depth &&
         search_depth_cnt > _max((search_settings.max_threads + 1) / 2, 2))
       continue;
 
-    delta = (depth >= START_ASPIRATION_DEPTH) ? INIT_ASPIRATION_WINDOW : MATE_SCORE;
-    alpha = _max(score - delta, -MATE_SCORE);
-    beta = _min(score + delta, MATE_SCORE);
+    // subtree sizes are counted per iteration
+    for (i = 0; i < sd->root_moves_cnt; i ++)
+      sd->root_moves[i].nodes = 0;
 
-    while (delta <= MATE_SCORE)
+    for (sd->pv_idx = 0; sd->pv_idx < search_status.multipv; sd->pv_idx ++)
     {
-      score = pvs(sd, 1, 1, alpha, beta, depth, 0, 0, 0);
+      line = &sd->pv_lines[sd->pv_idx];
+      score = line->score;
+
+      delta = (depth >= START_ASPIRATION_DEPTH) ? INIT_ASPIRATION_WINDOW : MATE_SCORE;
+      alpha = _max(score - delta, -MATE_SCORE);
+      beta = _min(score + delta, MATE_SCORE);
+
+      while (delta <= MATE_SCORE)
+      {
+        score = pvs(sd, 1, 1, alpha, beta, depth, 0, 0, 0);
+        if (search_status.done) break;
+
+        delta += 2 + delta / 2;
+        if (score <= alpha)
+        {
+          beta = (alpha + beta) / 2;
+          alpha = _max(score - delta, -MATE_SCORE);
+        }
+        else if (score >= beta)
+          beta = _min(score + delta, MATE_SCORE);
+        else
+          break;
+      }
       if (search_status.done) break;
 
-      delta += 2 + delta / 2;
-      if (score <= alpha)
+      sort_root_moves(sd->root_moves + sd->pv_idx, sd->root_moves_cnt - sd->pv_idx);
+
+      line->score = score;
+      line->depth = depth;
+      memcpy(line->pv, sd->pv, sizeof(line->pv));
+    }
+
+    // keep the lines sorted, the main line is the first one
+    if (sd->pv_idx > 0)
+    {
+      sort_root_moves(sd->root_moves, sd->pv_idx);
+      sort_pv_lines(sd->pv_lines, sd->pv_idx);
+
+      line = &sd->pv_lines[0];
+      memcpy(sd->pv, line->pv, sizeof(line->pv));
+      if (!search_status.done)
       {
-        beta = (alpha + beta) / 2;
-        alpha = _max(score - delta, -MATE_SCORE);
+        sd->score = score = line->score;
+        sd->depth = line->depth;
       }
-      else if (score >= beta)
-        beta = _min(score + delta, MATE_SCORE);
-      else
-        break;
     }
     if (search_status.done) break;
 
     if (sd->tid == 0)
     {
-      uci_info(pv);
+      uci_info(sd);
+
+      // the supervisor waits for the minimal depth after the deadline
+      if (depth == MIN_DEPTH_TO_REACH)
+      {
+        pthread_mutex_lock(&search_settings.mutex);
+        pthread_cond_signal(&search_settings.cond);
+        pthread_mutex_unlock(&search_settings.mutex);
+      }
 
       target_time = search_status.target_time[search_status.tm_steps];
       if (prev_score > score)
@@ -632,21 +897,89 @@ void *search_thread(void *thread_data)
     }
   }
 
-  if (sd->tid == 0)
+  // the result is the last completed iteration, the moves of an unfinished
+  // one are only kept when no iteration was completed
+  line = &sd->pv_lines[0];
+  if (line->depth > 0)
   {
-    uci_info(pv);
+    sd->score = line->score;
+    sd->depth = line->depth;
+    memcpy(sd->pv, line->pv, sizeof(line->pv));
+  }
 
+  if (sd->tid == 0)
+  {
     pthread_mutex_lock(&search_settings.mutex);
     search_status.search_finished = 1;
     if (!search_status.go.ponder)
       search_status.done = 1;
+    pthread_cond_signal(&search_settings.cond);
     pthread_mutex_unlock(&search_settings.mutex);
   }
+}
 
-  return NULL;
+// vote for the root move, weighted by the depth and the score of each thread,
+// the threads vote with their last completed iteration
+search_data_t *select_best_thread()
+{
+  int t, i, min_score;
+  int64_t votes[MAX_THREADS];
+  pv_line_t *line, *best_line, *lines[MAX_THREADS];
+  search_data_t *best_sd, *threads_sd;
+
+  threads_sd = search_settings.threads_search_data;
+  best_sd = &threads_sd[0];
+
+  // the lines of the main thread are reported together
+  if (search_status.multipv > 1)
+    return best_sd;
+
+  min_score = MATE_SCORE;
+  for (t = 0; t < search_settings.max_threads; t ++)
+  {
+    lines[t] = &threads_sd[t].pv_lines[0];
+    if (lines[t]->depth > 0 && lines[t]->score < min_score)
+      min_score = lines[t]->score;
+  }
+
+  for (t = 0; t < search_settings.max_threads; t ++)
+  {
+    votes[t] = 0;
+    line = lines[t];
+    if (line->depth == 0 || !_is_m(line->pv[0]))
+      continue;
+
+    for (i = 0; i < search_settings.max_threads; i ++)
+      if (lines[i]->depth > 0 && _m_eq(lines[i]->pv[0], line->pv[0]))
+        votes[t] += (int64_t)(lines[i]->score - min_score + 14) * lines[i]->depth;
+  }
+
+  for (t = 1; t < search_settings.max_threads; t ++)
+  {
+    line = lines[t];
+    best_line = lines[best_sd->tid];
+    if (votes[t] == 0)
+      continue;
+
+    // a thread without a completed iteration loses to any other one
+    if (best_line->depth == 0)
+      best_sd = &threads_sd[t];
+
+    // a proven mate is preferred over the votes
+    else if (_is_mate_score(best_line->score) || _is_mate_score(line->score))
+    {
+      if (line->score > best_line->score)
+        best_sd = &threads_sd[t];
+    }
+    else if (votes[t] > votes[best_sd->tid] ||
+             (votes[t] == votes[best_sd->tid] && line->depth > best_line->depth))
+      best_sd = &threads_sd[t];
+  }
+
+  return best_sd;
 }
 
-void print_best_move(search_data_t *sd)
+void print_best_move(search_data_t *sd, move_t *pv)
 {
   move_t best_move, ponder_move;
   hash_data_t hash_data;
@@ -677,19 +1010,11 @@ void print_best_move(search_data_t *sd)
 
 void reset_search_data(search_data_t *sd)
 {
-  int i, j, k;
-  uint64_t hash_key;
-
-  hash_key = sd->hash_keys[0];
   memset(sd, 0, sizeof(search_data_t));
-
   sd->pos = sd->pos_list;
-  sd->hash_key = hash_key;
 
-  for (i = 0; i < P_LIMIT; i ++)
-    for (j = 0; j < BOARD_SIZE; j ++)
-      for (k = 0; k < P_LIMIT * BOARD_SIZE; k ++)
-        sd->counter_move_history[i][j][k] = -1;
+  // all bytes set gives -1 for each int16_t item
+  memset(sd->counter_move_history, 0xff, sizeof(sd->counter_move_history));
 }
 
 void reset_threads_search_data()
@@ -703,7 +1028,7 @@ void reset_threads_search_data()
 void full_reset_search_data()
 {
   reset_search_data(search_settings.sd);
-  reset_hash_key(search_settings.sd);
+  clear_hash();
   reset_threads_search_data();
 }
 
@@ -717,15 +1042,78 @@ void init_search_data(search_data_t *sd, search_data_t *src_sd, int t)
   sd->hash_keys_cnt = src_sd->hash_keys_cnt;
   memcpy(sd->hash_keys, src_sd->hash_keys, sizeof(sd->hash_keys));
 
-  sd->nodes = sd->tbhits = 0;
+  sd->score = sd->depth = sd->pv_idx = 0;
+  sd->pv[0] = 0;
+  memset(sd->pv_lines, 0, sizeof(sd->pv_lines));
+
+  sd->root_moves_cnt = src_sd->root_moves_cnt;
+  memcpy(sd->root_moves, src_sd->root_moves,
+         src_sd->root_moves_cnt * sizeof(root_move_t));
+
+  sd->nodes = sd->nodes_synced = sd->tbhits = 0;
+  set_nodes_sync(sd, search_status.go.nodes);
+  memset(&sd->hash_stats, 0, sizeof(hash_stats_t));
+#ifdef _STATS
+  memset(sd->stats, 0, sizeof(sd->stats));
+  sd->prefetches = sd->phash_probes = sd->phash_hits = 0;
+#endif
+}
+
+
+static int in_searchmoves(move_t move)
+{
+  int i;
+
+  for (i = 0; i < search_status.go.searchmoves_cnt; i ++)
+    if (_m_eq(move, search_status.go.searchmoves[i]))
+      return 1;
+  return 0;
+}
+
+// the root moves start in the move picker order, restricted to
+// "go searchmoves" if any of them is legal
+static void init_root_moves(search_data_t *sd)
+{
+  int i, j, moves_cnt;
+  move_t move, hash_move, moves[MAX_MOVES];
+  hash_data_t hash_data;
+  move_list_t move_list;
+  position_t *pos;
+
+  pos = sd->pos;
+  hash_data = get_hash_data(sd);
+  hash_move = hash_data.raw ? hash_data.move : 0;
+  if (_is_m(hash_move) && !is_pseudo_legal(pos, hash_move))
+    hash_move = 0;
+
+  moves_cnt = 0;
+  init_move_list(&move_list, SEARCH, pos->in_check);
+  while ((move = next_move(&move_list, sd, hash_move, 1, 0)))
+    if (legal_move(pos, move))
+      moves[moves_cnt ++] = move;
+
+  sd->root_moves_cnt = 0;
+  for (j = 0; j < 2 && sd->root_moves_cnt == 0; j ++)
+    for (i = 0; i < moves_cnt; i ++)
+    {
+      if (j == 0 && search_status.go.searchmoves_cnt > 0 &&
+          !in_searchmoves(moves[i]))
+        continue;
+
+      sd->root_moves[sd->root_moves_cnt].move = moves[i];
+      sd->root_moves[sd->root_moves_cnt].score = -MATE_SCORE;
+      sd->root_moves[sd->root_moves_cnt].nodes = 0;
+      sd->root_moves_cnt ++;
+    }
 }
 
-void *search()
+static void search()
 {
   int t;
+  uint64_t deadline;
+  struct timespec deadline_ts;
   move_t tb_move;
-  search_data_t *sd;
-  pthread_t threads[MAX_THREADS];
+  search_data_t *sd, *best_sd;
 
   sd = search_settings.sd;
   search_status.tm_steps = 0;
@@ -734,52 +1122,173 @@ void *search()
   set_hash_iteration();
   reevaluate_position(sd->pos);
 
-  memset(pv, 0, sizeof(pv));
   memset(shared_search_depth_cnt, 0, sizeof(shared_search_depth_cnt));
+  search_status.nodes = 0;
+  init_root_moves(sd);
+  search_status.multipv = _max(_min(search_settings.multipv, sd->root_moves_cnt), 1);
 
   // prepare search threads
   for (t = 0; t < search_settings.max_threads; t ++)
     init_search_data(&search_settings.threads_search_data[t], sd, t);
 
   // probe tablebases
-  if (TB_LARGEST > 0 && !sd->pos->c_flag && _popcnt(_occ(sd->pos)) <= TB_LARGEST)
+  if (TB_LARGEST > 0 && !sd->pos->c_flag && _popcnt(_occ(sd->pos)) <= TB_LARGEST &&
+      search_status.go.searchmoves_cnt == 0)
   {
     tb_move = tablebases_probe_root(sd->pos);
     if (_is_m(tb_move))
     {
-      pv[0] = tb_move; pv[1] = 0;
-
-      search_status.depth = 1;
-      search_status.score = _m_score(tb_move);
-      search_settings.threads_search_data[0].tbhits = 1;
+      search_status.multipv = 1;
+      best_sd = &search_settings.threads_search_data[0];
+      best_sd->pv[0] = tb_move; best_sd->pv[1] = 0;
+      best_sd->depth = 1;
+      best_sd->score = _m_score(tb_move);
+      best_sd->tbhits = 1;
 
-      uci_info(pv);
-      print_best_move(sd);
+      uci_info(best_sd);
+      print_best_move(sd, best_sd->pv);
 
-      return NULL;
+      return;
     }
   }
 
-  // launch search threads
-  for (t = 0; t < search_settings.max_threads; t ++)
-    pthread_create(&threads[t], NULL, search_thread, (void *) &search_settings.threads_search_data[t]);
+  deadline = search_status.time_in_ms + search_status.max_time;
+  deadline_ts.tv_sec = deadline / 1000;
+  deadline_ts.tv_nsec = (deadline % 1000) * 1000000;
+
+  // wake up the search threads
+  pthread_mutex_lock(&search_settings.mutex);
+  thread_pool.running = thread_pool.threads_cnt;
+  thread_pool.generation ++;
+  pthread_cond_broadcast(&thread_pool.start_cond);
 
+  // sleep until the deadline, stop/ponderhit and the main search thread
+  // wake the supervisor earlier
   while (!search_status.done)
   {
-    pthread_mutex_lock(&search_settings.mutex);
-    if (!search_status.go.infinite &&
-        !search_status.go.ponder &&
-        time_in_ms() - search_status.time_in_ms >= search_status.max_time &&
-        search_status.depth >= MIN_DEPTH_TO_REACH)
+    if (search_status.go.infinite || search_status.go.ponder)
+      pthread_cond_wait(&search_settings.cond, &search_settings.mutex);
+    else if (time_in_ms() < deadline)
+      pthread_cond_timedwait(&search_settings.cond, &search_settings.mutex, &deadline_ts);
+    else if (search_settings.threads_search_data[0].depth >= MIN_DEPTH_TO_REACH)
       search_status.done = 1;
+    else
+      pthread_cond_wait(&search_settings.cond, &search_settings.mutex);
+  }
+
+  while (thread_pool.running)
+    pthread_cond_wait(&thread_pool.idle_cond, &search_settings.mutex);
+  pthread_mutex_unlock(&search_settings.mutex);
+
+  // the final info is printed after all threads stop, with the total nodes
+  best_sd = select_best_thread();
+  uci_info(best_sd);
+#ifdef _STATS
+  print_stats();
+#endif
+
+  print_best_move(sd, best_sd->pv);
+}
+
+// each worker is bound to its node once, and keeps its search data warm
+void *worker_thread(void *thread_data)
+{
+  uint64_t generation;
+  search_data_t *sd;
+
+  sd = (search_data_t *)thread_data;
+  numa_bind_thread(sd->tid);
+
+  // a search might be started before the thread runs
+  generation = thread_pool.start_generation;
+
+  pthread_mutex_lock(&search_settings.mutex);
+  while (1)
+  {
+    while (thread_pool.generation == generation && !thread_pool.exit)
+      pthread_cond_wait(&thread_pool.start_cond, &search_settings.mutex);
+    if (thread_pool.exit)
+      break;
+
+    generation = thread_pool.generation;
     pthread_mutex_unlock(&search_settings.mutex);
 
-    sleep_ms(2);
+    search_thread(sd);
+
+    pthread_mutex_lock(&search_settings.mutex);
+    if (-- thread_pool.running == 0)
+      pthread_cond_broadcast(&thread_pool.idle_cond);
   }
+  pthread_mutex_unlock(&search_settings.mutex);
 
-  for (t = 0; t < search_settings.max_threads; t ++)
-    pthread_join(threads[t], NULL);
+  return NULL;
+}
+
+void *supervisor_thread(void *arg)
+{
+  pthread_mutex_lock(&search_settings.mutex);
+  while (1)
+  {
+    while (!thread_pool.go)
+      pthread_cond_wait(&search_settings.cond, &search_settings.mutex);
+    thread_pool.go = 0;
+    pthread_mutex_unlock(&search_settings.mutex);
+
+    search();
+
+    pthread_mutex_lock(&search_settings.mutex);
+    thread_pool.searching = 0;
+    pthread_cond_broadcast(&thread_pool.idle_cond);
+  }
 
-  print_best_move(sd);
   return NULL;
 }
+
+void start_threads()
+{
+  int t;
+
+  if (!thread_pool.supervisor_started)
+  {
+    pthread_create(&thread_pool.supervisor, NULL, supervisor_thread, NULL);
+    thread_pool.supervisor_started = 1;
+  }
+
+  thread_pool.start_generation = thread_pool.generation;
+  for (t = 0; t < search_settings.max_threads; t ++)
+    pthread_create(&thread_pool.threads[t], NULL, worker_thread,
+                   (void *) &search_settings.threads_search_data[t]);
+  thread_pool.threads_cnt = search_settings.max_threads;
+}
+
+void stop_threads()
+{
+  int t;
+
+  pthread_mutex_lock(&search_settings.mutex);
+  thread_pool.exit = 1;
+  pthread_cond_broadcast(&thread_pool.start_cond);
+  pthread_mutex_unlock(&search_settings.mutex);
+
+  for (t = 0; t < thread_pool.threads_cnt; t ++)
+    pthread_join(thread_pool.threads[t], NULL);
+
+  thread_pool.threads_cnt = 0;
+  thread_pool.exit = 0;
+}
+
+void start_search()
+{
+  pthread_mutex_lock(&search_settings.mutex);
+  thread_pool.go = thread_pool.searching = 1;
+  pthread_cond_signal(&search_settings.cond);
+  pthread_mutex_unlock(&search_settings.mutex);
+}
+
+void wait_search()
+{
+  pthread_mutex_lock(&search_settings.mutex);
+  while (thread_pool.searching)
+    pthread_cond_wait(&thread_pool.idle_cond, &search_settings.mutex);
+  pthread_mutex_unlock(&search_settings.mutex);
+}
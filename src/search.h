@@ -21,37 +21,71 @@
 
 #include <pthread.h>
 
+#include "material.h"
+#include "memory.h"
 #include "move.h"
+#include "phash.h"
 #include "position.h"
+#include "stats.h"
 #include "util.h"
 
 #define MAX_GAME_PLY  1024
 #define TM_STEPS      10
+#define MAX_MULTIPV   64
 
 typedef struct {
-  int tid, hash_keys_cnt;
-  uint64_t nodes, tbhits, hash_key;
+  uint64_t probes, hits, cutoffs, replacements, collisions;
+} hash_stats_t;
+
+typedef struct {
+  int score, depth;
+  move_t pv[PLY_LIMIT];
+} pv_line_t;
+
+typedef struct {
+  move_t move;
+  int score;
+  uint64_t nodes;
+} root_move_t;
+
+typedef struct {
+  int tid, hash_keys_cnt, score, depth, pv_idx, root_moves_cnt;
+  uint64_t nodes, nodes_synced, nodes_sync, tbhits, hash_key;
+  hash_stats_t hash_stats;
   position_t *pos,
               pos_list[PLY_LIMIT];
-  move_t   killer_moves[PLY_LIMIT][MAX_KILLER_MOVES],
-           counter_moves[P_LIMIT][BOARD_SIZE];
+  pv_line_t pv_lines[MAX_MULTIPV];
+  root_move_t root_moves[MAX_MOVES];
+  move_t   pv[PLY_LIMIT * PLY_LIMIT],
+           killer_moves[PLY_LIMIT][MAX_KILLER_MOVES],
+           counter_moves[H_LIMIT][BOARD_SIZE];
   int16_t  history[N_SIDES][BOARD_SIZE][BOARD_SIZE],
-           counter_move_history[P_LIMIT][BOARD_SIZE][P_LIMIT * BOARD_SIZE];
+           counter_move_history[H_LIMIT][BOARD_SIZE][H_LIMIT * BOARD_SIZE];
   uint64_t hash_keys[MAX_GAME_PLY];
+  phash_item_t phash_items[PHASH_SIZE];
+  material_item_t material_items[MATERIAL_HASH_SIZE];
+#ifdef _STATS
+  search_stats_t stats[STATS_DEPTH];
+  uint64_t prefetches, phash_probes, phash_hits;
+#endif
 } search_data_t;
 
 typedef struct {
-  int max_depth, done, search_finished, score, depth, tm_steps;
-  uint64_t time_in_ms, max_time, target_time[TM_STEPS];
+  int max_depth, done, search_finished, tm_steps, multipv;
+  uint64_t time_in_ms, max_time, target_time[TM_STEPS], nodes;
   struct {
-    int infinite, ponder, time, inc, movestogo, depth, movetime;
+    int infinite, ponder, time, inc, movestogo, depth, movetime, searchmoves_cnt;
+    uint64_t nodes;
+    move_t searchmoves[MAX_MOVES];
   } go;
 } search_status_t;
 
 typedef struct {
-  int max_threads, ponder_mode, tb_probe_depth;
+  int max_threads, ponder_mode, tb_probe_depth, abdada, multipv;
   search_data_t *sd, *threads_search_data;
+  mem_block_t threads_mem;
   pthread_mutex_t mutex;
+  pthread_cond_t cond;
 } search_settings_t;
 
 extern search_settings_t search_settings;
@@ -61,6 +95,9 @@ void init_lmr();
 void reset_search_data(search_data_t *);
 void reset_threads_search_data();
 void full_reset_search_data();
-void *search();
+void start_threads();
+void stop_threads();
+void start_search();
+void wait_search();
 
 #endif
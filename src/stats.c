@@ -0,0 +1,69 @@
+/*
+  Xiphos, a UCI chess engine
+  Copyright (C) 2018, 2019 Milos Tatarevic
+
+  Xiphos is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Xiphos is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "search.h"
+#include "stats.h"
+
+#ifdef _STATS
+
+// the counters of all threads, a row per depth (qsearch nodes at depth 0)
+void print_stats()
+{
+  int t, d;
+  search_stats_t s, *ts;
+
+  _p("info string %5s %10s %9s %9s %9s %8s %8s %8s %9s %9s %8s %8s %6s %9s %6s\n",
+     "depth", "nodes", "tt_cut", "null", "null_cut", "probcut", "razor", "futility",
+     "lmp", "see", "cmh", "lmr_re", "se", "fail_hi", "first%");
+
+  for (d = 0; d < STATS_DEPTH; d ++)
+  {
+    memset(&s, 0, sizeof(search_stats_t));
+    for (t = 0; t < search_settings.max_threads; t ++)
+    {
+      ts = &search_settings.threads_search_data[t].stats[d];
+
+      s.nodes += ts->nodes;
+      s.tt_cutoffs += ts->tt_cutoffs;
+      s.null_tries += ts->null_tries;
+      s.null_cutoffs += ts->null_cutoffs;
+      s.probcut_cutoffs += ts->probcut_cutoffs;
+      s.razor_cutoffs += ts->razor_cutoffs;
+      s.futility_cutoffs += ts->futility_cutoffs;
+      s.lmp_prunes += ts->lmp_prunes;
+      s.see_prunes += ts->see_prunes;
+      s.cmh_prunes += ts->cmh_prunes;
+      s.lmr_researches += ts->lmr_researches;
+      s.singular_extensions += ts->singular_extensions;
+      s.fail_highs += ts->fail_highs;
+      s.first_fail_highs += ts->first_fail_highs;
+    }
+    if (s.nodes == 0)
+      continue;
+
+    _p("info string %5d %10"PRIu64" %9"PRIu64" %9"PRIu64" %9"PRIu64" %8"PRIu64
+       " %8"PRIu64" %8"PRIu64" %9"PRIu64" %9"PRIu64" %8"PRIu64" %8"PRIu64
+       " %6"PRIu64" %9"PRIu64" %6.1f\n",
+       d, s.nodes, s.tt_cutoffs, s.null_tries, s.null_cutoffs, s.probcut_cutoffs,
+       s.razor_cutoffs, s.futility_cutoffs, s.lmp_prunes, s.see_prunes,
+       s.cmh_prunes, s.lmr_researches, s.singular_extensions, s.fail_highs,
+       s.fail_highs ? 100.0 * s.first_fail_highs / s.fail_highs : 0.0);
+  }
+}
+
+#endif
@@ -0,0 +1,44 @@
+/*
+  Xiphos, a UCI chess engine
+  Copyright (C) 2018, 2019 Milos Tatarevic
+
+  Xiphos is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Xiphos is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <inttypes.h>
+
+#define STATS_DEPTH   32
+
+// search statistics are collected only in the stats build (make stats)
+typedef struct {
+  uint64_t nodes, tt_cutoffs, null_tries, null_cutoffs, probcut_cutoffs,
+           razor_cutoffs, futility_cutoffs, lmp_prunes, see_prunes, cmh_prunes,
+           lmr_researches, singular_extensions, fail_highs, first_fail_highs;
+} search_stats_t;
+
+#ifdef _STATS
+  #define _stat(sd, field, depth)                                              \
+    ((sd)->stats[(depth) < 0 ? 0 : _min(depth, STATS_DEPTH - 1)].field ++)
+  #define _stat_inc(sd, field)    ((sd)->field ++)
+
+  void print_stats();
+#else
+  #define _stat(sd, field, depth)
+  #define _stat_inc(sd, field)
+#endif
+
+#endif
@@ -19,12 +19,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
+#include "bench.h"
 #include "game.h"
 #include "hash.h"
 #include "make.h"
+#include "numa.h"
 #include "perft.h"
-#include "phash.h"
 #include "position.h"
 #include "search.h"
 #include "fathom/tbprobe.h"
@@ -40,14 +42,22 @@
 #define CMD_POSITION_STARTPOS       "position startpos"
 
 #define CMD_PERFT                   "perft"
+#define CMD_BENCH                   "bench"
 #define CMD_TEST                    "test"
 #define CMD_PRINT                   "print"
+#define CMD_SAVE_HASH               "savehash"
+#define CMD_LOAD_HASH               "loadhash"
+#define CMD_HASH_STATS              "hashstats"
 
 #define OPTION_HASH                 "setoption name Hash value"
 #define OPTION_THREADS              "setoption name Threads value"
 #define OPTION_PONDER               "setoption name Ponder value"
 #define OPTION_SYZYGY_PATH          "setoption name SyzygyPath value"
 #define OPTION_SYZYGY_PROBE_DEPTH   "setoption name SyzygyProbeDepth value"
+#define OPTION_NUMA                 "setoption name NUMA value"
+#define OPTION_SHARED_HASH          "setoption name SharedHash value"
+#define OPTION_ABDADA               "setoption name ABDADA value"
+#define OPTION_MULTIPV              "setoption name MultiPV value"
 
 #define MAX_REDUCE_TIME             1000
 #define REDUCE_TIME                 150
@@ -56,6 +66,10 @@
 #define MIN_TIME_RATIO              0.5
 #define MAX_TIME_RATIO              1.2
 
+#define BENCH_DEPTH                 13
+#define BENCH_THREADS               1
+#define BENCH_HASH_SIZE_IN_MB       16
+
 #define MAX_MOVES_TO_GO             25
 #define BUFFER_LINE_SIZE            256
 #define READ_BUFFER_SIZE            65536
@@ -98,7 +112,9 @@ void read_fen(search_data_t *sd, char *buf)
   char c, *moves_buf;
   int i, sq, side;
 
-  reset_search_data(sd);
+  // only the position is reset, the history tables are left untouched
+  sd->pos = sd->pos_list;
+  memset(sd->pos, 0, sizeof(position_t));
   pos = sd->pos;
 
   for(i = 0; i < BOARD_SIZE; i ++)
@@ -161,9 +177,9 @@ void read_fen(search_data_t *sd, char *buf)
   if (buf[i] != '-')
     pos->ep_sq = _chr_to_sq(buf[i], buf[i + 1]);
 
-  set_phase(pos);
   reevaluate_position(pos);
   set_pins_and_checks(pos);
+  set_hash_keys(sd);
 
   moves_buf = strstr(buf, "moves");
   if (moves_buf)
@@ -187,15 +203,24 @@ void uci_position_startpos(char *buf)
   }
 }
 
+static int is_move_str(char *t)
+{
+  return strlen(t) >= 4 &&
+         t[0] >= 'a' && t[0] <= 'h' && t[1] >= '1' && t[1] <= '8' &&
+         t[2] >= 'a' && t[2] <= 'h' && t[3] >= '1' && t[3] <= '8';
+}
+
 void parse_go_cmd(char *buf)
 {
-  int i, max_time_allowed, target_time, max_time, reduce_time, moves_to_go;
+  int i, max_time_allowed, target_time, max_time, reduce_time, moves_to_go,
+      searchmoves;
   double ratio;
   char *t;
   position_t *pos;
 
   pos = search_settings.sd->pos;
   memset(&search_status, 0, sizeof(search_status));
+  searchmoves = 0;
 
   for (t = strtok(buf, " "); t; t = strtok(NULL, " "))
   {
@@ -234,6 +259,20 @@ void parse_go_cmd(char *buf)
       t = strtok(NULL, " ");
       search_status.go.movetime = atoi(t);
     }
+    else if (!strcmp(t, "nodes"))
+    {
+      t = strtok(NULL, " ");
+      search_status.go.nodes = strtoull(t, NULL, 10);
+    }
+    else if (!strcmp(t, "searchmoves"))
+    {
+      searchmoves = 1;
+    }
+    else if (searchmoves && is_move_str(t) &&
+             search_status.go.searchmoves_cnt < MAX_MOVES)
+    {
+      search_status.go.searchmoves[search_status.go.searchmoves_cnt ++] = str_to_m(t);
+    }
   }
 
   search_status.max_time = (1 << 30);
@@ -246,6 +285,11 @@ void parse_go_cmd(char *buf)
     search_status.max_depth =
       _min(search_status.go.depth, search_status.max_depth);
   }
+  // a node limit without a clock searches without a time limit, otherwise
+  // the node and the time limits both apply
+  else if (search_status.go.nodes > 0 &&
+           search_status.go.movetime == 0 && search_status.go.time == 0)
+    ;
   else
   {
     if (search_status.go.movetime > 0)
@@ -309,13 +353,12 @@ void uci_perft(char *buf)
       depth, nodes, time_ms, nodes * 1000 / (time_ms + 1));
 }
 
-void uci_info(move_t *pv)
+static void print_info(int depth, int multipv, int score, move_t *pv)
 {
-  int i, score;
+  int i;
   char buf[BUFFER_LINE_SIZE], pv_string[PLY_LIMIT * 8];
   uint64_t nodes, tbhits, elapsed_time;
 
-  score = search_status.score;
   if (_is_mate_score(score))
     sprintf(buf, "mate %d", (score > 0 ? MATE_SCORE - score + 1 : -MATE_SCORE - score) / 2);
   else
@@ -330,9 +373,12 @@ void uci_info(move_t *pv)
 
   elapsed_time = time_in_ms() - search_status.time_in_ms;
 
-  _p("info depth %d score %s nodes %"PRIu64" tbhits %"PRIu64" time %"PRIu64" nps %"PRIu64" ",
-      search_status.depth, buf, nodes, tbhits, elapsed_time,
-      nodes * UINT64_C(1000) / (elapsed_time + 1));
+  _p("info depth %d ", depth);
+  if (multipv > 0)
+    _p("multipv %d ", multipv);
+  _p("score %s nodes %"PRIu64" tbhits %"PRIu64" time %"PRIu64" nps %"PRIu64" hashfull %d ",
+      buf, nodes, tbhits, elapsed_time,
+      nodes * UINT64_C(1000) / (elapsed_time + 1), hash_full());
 
   sprintf(pv_string, "pv ");
   for (; *pv; pv ++)
@@ -345,6 +391,77 @@ void uci_info(move_t *pv)
   _p(pv_string);
 }
 
+void uci_info(search_data_t *sd)
+{
+  int i;
+
+  if (search_status.multipv <= 1)
+  {
+    print_info(sd->depth, 0, sd->score, sd->pv);
+    return;
+  }
+
+  for (i = 0; i < search_status.multipv && sd->pv_lines[i].depth > 0; i ++)
+    print_info(sd->pv_lines[i].depth, i + 1, sd->pv_lines[i].score, sd->pv_lines[i].pv);
+}
+
+void uci_hash_stats()
+{
+  int i;
+  hash_stats_t stats, *sd_stats;
+#ifdef _STATS
+  uint64_t nodes, prefetches, phash_probes, phash_hits;
+
+  nodes = prefetches = phash_probes = phash_hits = 0;
+#endif
+  memset(&stats, 0, sizeof(stats));
+  for (i = 0; i < search_settings.max_threads; i ++)
+  {
+#ifdef _STATS
+    nodes += search_settings.threads_search_data[i].nodes;
+    prefetches += search_settings.threads_search_data[i].prefetches;
+    phash_probes += search_settings.threads_search_data[i].phash_probes;
+    phash_hits += search_settings.threads_search_data[i].phash_hits;
+#endif
+
+    sd_stats = &search_settings.threads_search_data[i].hash_stats;
+    stats.probes += sd_stats->probes;
+    stats.hits += sd_stats->hits;
+    stats.cutoffs += sd_stats->cutoffs;
+    stats.replacements += sd_stats->replacements;
+    stats.collisions += sd_stats->collisions;
+  }
+
+  _p("info string hash probes %"PRIu64" hits %"PRIu64" (%.1f%%) cutoffs %"PRIu64
+     " replacements %"PRIu64" collisions %"PRIu64" hashfull %d\n",
+     stats.probes, stats.hits, 100.0 * stats.hits / (stats.probes + 1),
+     stats.cutoffs, stats.replacements, stats.collisions, hash_full());
+
+  // the pawn hash and prefetch counters are kept in the stats build only
+#ifdef _STATS
+  _p("info string pawn hash probes %"PRIu64" hits %"PRIu64" (%.1f%%)\n",
+     phash_probes, phash_hits, 100.0 * phash_hits / (phash_probes + 1));
+  _p("info string prefetches %"PRIu64" per node %.2f\n",
+     prefetches, (double)prefetches / (nodes + 1));
+#endif
+}
+
+static void print_shared_hash_mode()
+{
+  switch (hash_mode())
+  {
+    case HASH_SHARED_CREATED:
+      _p("info string shared hash %s created\n", hash_shm_name()); break;
+    case HASH_SHARED_ATTACHED:
+      _p("info string shared hash %s attached\n", hash_shm_name()); break;
+    case HASH_SHARED_FAILED:
+      _p("info string unable to share hash as %s, using a private table\n",
+         hash_shm_name()); break;
+    default:
+      _p("info string using a private hash table\n");
+  }
+}
+
 void set_hash_size(int hash_size_in_mb)
 {
   uint64_t allocated_memory;
@@ -353,28 +470,143 @@ void set_hash_size(int hash_size_in_mb)
     return;
 
   allocated_memory = init_hash(hash_size_in_mb);
-  reset_hash_key(search_settings.sd);
-  _p("info hash=%"PRIu64"MB\n", allocated_memory >> 20);
+  _p("info string hash=%"PRIu64"MB pages=%s\n",
+     allocated_memory >> 20, hash_page_size());
+
+  // the shared segment is recreated or attached at the new size
+  if (hash_shm_name()[0])
+    print_shared_hash_mode();
+}
+
+void set_shared_hash(char *buf)
+{
+  buf[strcspn(buf, "\r\n")] = 0;
+  if (!strcmp(buf, "<empty>"))
+    buf[0] = 0;
+
+  set_hash_shm_name(buf);
+  print_shared_hash_mode();
+}
+
+void uci_save_hash(char *buf)
+{
+  buf[strcspn(buf, "\r\n")] = 0;
+  if (!strlen(buf))
+  {
+    _p("specify file name\n");
+    return;
+  }
+
+  if (save_hash(buf) == HASH_FILE_OK)
+    _p("info string hash saved to %s\n", buf);
+  else
+    _p("info string unable to save hash to %s\n", buf);
+}
+
+void uci_load_hash(char *buf)
+{
+  buf[strcspn(buf, "\r\n")] = 0;
+  if (!strlen(buf))
+  {
+    _p("specify file name\n");
+    return;
+  }
+
+  switch (load_hash(buf))
+  {
+    case HASH_FILE_OK:
+      _p("info string hash loaded from %s\n", buf); break;
+    case HASH_FILE_INCOMPATIBLE:
+      _p("info string %s is not a compatible hash file\n", buf); break;
+    case HASH_FILE_SIZE_MISMATCH:
+      _p("info string %s was saved with a different Hash size\n", buf); break;
+    default:
+      _p("info string unable to load hash from %s\n", buf);
+  }
+}
+
+static void bind_threads_search_data()
+{
+  if (!numa_bind_slices(&search_settings.threads_mem, sizeof(search_data_t)))
+    _p("info string unable to bind the search data to the numa nodes\n");
 }
 
 void set_max_threads(int thread_cnt)
 {
+  stop_threads();
+
   search_settings.max_threads = _max(_min(thread_cnt, MAX_THREADS), 1);
+  mem_alloc(&search_settings.threads_mem,
+            search_settings.max_threads * sizeof(search_data_t));
   search_settings.threads_search_data =
-    (search_data_t *) realloc(
-      search_settings.threads_search_data, search_settings.max_threads * sizeof(search_data_t)
-    );
-  init_phash(search_settings.max_threads);
+    (search_data_t *) search_settings.threads_mem.ptr;
+  bind_threads_search_data();
   reset_threads_search_data();
+
+  start_threads();
   _p("info threads=%d\n", search_settings.max_threads);
 }
 
+// bench [depth] [threads] [hash], the node count is the signature of the search
+void uci_bench(char *buf)
+{
+  int depth, threads, hash_size, multipv;
+  uint64_t nodes, time_ms;
+
+  depth = threads = hash_size = 0;
+  sscanf(buf, "%d %d %d", &depth, &threads, &hash_size);
+  if (depth < 1) depth = BENCH_DEPTH;
+  if (threads < 1) threads = BENCH_THREADS;
+  if (hash_size < 1) hash_size = BENCH_HASH_SIZE_IN_MB;
+
+  multipv = search_settings.multipv;
+  search_settings.multipv = 1;
+  set_max_threads(threads);
+  set_hash_size(hash_size);
+
+  time_ms = time_in_ms();
+  nodes = bench(depth);
+  time_ms = time_in_ms() - time_ms;
+
+  search_settings.multipv = multipv;
+  full_reset_search_data();
+  read_fen(search_settings.sd, initial_fen);
+
+  _p("bench(%d)=%"PRIu64", time: %"PRIu64"ms, nps: %"PRIu64" (threads: %d, hash: %dMB)\n",
+      depth, nodes, time_ms, nodes * 1000 / (time_ms + 1), threads, hash_size);
+}
+
 void set_ponder(char *buf)
 {
   search_settings.ponder_mode = starts_with(buf, "true");
   _p("ponder=%d\n", search_settings.ponder_mode);
 }
 
+void set_numa_mode(char *buf)
+{
+  set_numa(starts_with(buf, "true"));
+
+  // move the memory that is already in use, and rebind the threads
+  stop_threads();
+  bind_threads_search_data();
+  set_hash_numa_policy();
+  start_threads();
+
+  _p("numa=%d nodes=%d\n", numa_enabled(), numa_nodes());
+}
+
+void set_abdada(char *buf)
+{
+  search_settings.abdada = starts_with(buf, "true");
+  _p("abdada=%d\n", search_settings.abdada);
+}
+
+void set_multipv(int multipv)
+{
+  search_settings.multipv = _max(_min(multipv, MAX_MULTIPV), 1);
+  _p("multipv=%d\n", search_settings.multipv);
+}
+
 void set_syzygy_path(char *buf)
 {
   buf[strlen(buf) - 1] = 0;
@@ -391,17 +623,21 @@ void set_syzygy_probe_depth(int depth)
 
 void uci()
 {
-  pthread_t main_search_thread;
-  int searching;
   char *buf, input_buf[READ_BUFFER_SIZE];
+  pthread_condattr_t cond_attr;
 
   _p("%s %s by %s\n", VERSION, ARCH, AUTHOR);
 
-  searching = 0;
   search_settings.sd = (search_data_t *) malloc(sizeof(search_data_t));
   search_settings.threads_search_data = NULL;
   pthread_mutex_init(&search_settings.mutex, NULL);
 
+  // the search deadlines are measured on the monotonic clock
+  pthread_condattr_init(&cond_attr);
+  pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&search_settings.cond, &cond_attr);
+
+  search_settings.multipv = 1;
   set_max_threads(DEFAULT_THREADS);
   set_hash_size(DEFAULT_HASH_SIZE_IN_MB);
   search_settings.ponder_mode = 0;
@@ -432,6 +668,10 @@ void uci()
       _p("option name Ponder type check default false\n");
       _p("option name SyzygyPath type string default <empty>\n");
       _p("option name SyzygyProbeDepth type spin default 1 min 1 max %d\n", MAX_DEPTH);
+      _p("option name NUMA type check default false\n");
+      _p("option name SharedHash type string default <empty>\n");
+      _p("option name ABDADA type check default false\n");
+      _p("option name MultiPV type spin default 1 min 1 max %d\n", MAX_MULTIPV);
       _p("uciok\n");
     }
 
@@ -439,7 +679,10 @@ void uci()
       _p("readyok\n");
 
     else if (_cmd_cmp(&buf, CMD_QUIT))
+    {
+      release_hash();
       break;
+    }
 
     else if (_cmd_cmp(&buf, CMD_STOP))
     {
@@ -447,13 +690,10 @@ void uci()
       search_status.done = 1;
       search_status.go.infinite = 0;
       search_status.go.ponder = 0;
+      pthread_cond_signal(&search_settings.cond);
       pthread_mutex_unlock(&search_settings.mutex);
 
-      if (searching)
-      {
-        pthread_join(main_search_thread, NULL);
-        searching = 0;
-      }
+      wait_search();
     }
     else if (_cmd_cmp(&buf, CMD_PONDERHIT))
     {
@@ -461,13 +701,11 @@ void uci()
       search_status.go.ponder = 0;
       if (search_status.search_finished)
         search_status.done = 1;
+      pthread_cond_signal(&search_settings.cond);
       pthread_mutex_unlock(&search_settings.mutex);
 
-      if (search_status.done && searching)
-      {
-        pthread_join(main_search_thread, NULL);
-        searching = 0;
-      }
+      if (search_status.done)
+        wait_search();
     }
 
     else if (_cmd_cmp(&buf, CMD_NEW_GAME))
@@ -485,12 +723,24 @@ void uci()
     else if (_cmd_cmp(&buf, CMD_PERFT))
       uci_perft(buf);
 
+    else if (_cmd_cmp(&buf, CMD_BENCH))
+      uci_bench(buf);
+
     else if (_cmd_cmp(&buf, CMD_TEST))
       run_tests();
 
     else if (_cmd_cmp(&buf, CMD_PRINT))
       print_board(search_settings.sd->pos);
 
+    else if (_cmd_cmp(&buf, CMD_SAVE_HASH))
+      uci_save_hash(buf);
+
+    else if (_cmd_cmp(&buf, CMD_LOAD_HASH))
+      uci_load_hash(buf);
+
+    else if (_cmd_cmp(&buf, CMD_HASH_STATS))
+      uci_hash_stats();
+
     else if (_cmd_cmp(&buf, OPTION_HASH))
       set_hash_size(atoi(buf));
 
@@ -506,14 +756,23 @@ void uci()
     else if (_cmd_cmp(&buf, OPTION_SYZYGY_PROBE_DEPTH))
       set_syzygy_probe_depth(atoi(buf));
 
+    else if (_cmd_cmp(&buf, OPTION_NUMA))
+      set_numa_mode(buf);
+
+    else if (_cmd_cmp(&buf, OPTION_SHARED_HASH))
+      set_shared_hash(buf);
+
+    else if (_cmd_cmp(&buf, OPTION_ABDADA))
+      set_abdada(buf);
+
+    else if (_cmd_cmp(&buf, OPTION_MULTIPV))
+      set_multipv(atoi(buf));
+
     else if (_cmd_cmp(&buf, CMD_GO))
     {
-      if (searching)
-        pthread_join(main_search_thread, NULL);
-
+      wait_search();
       parse_go_cmd(buf);
-      pthread_create(&main_search_thread, NULL, search, NULL);
-      searching = 1;
+      start_search();
     }
   }
 }
@@ -24,7 +24,8 @@
 extern char initial_fen[];
 
 void read_fen(search_data_t *, char *);
-void uci_info(move_t *);
+void parse_go_cmd(char *);
+void uci_info(search_data_t *);
 void uci();
 
 #endif
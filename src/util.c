@@ -65,7 +65,7 @@ move_t str_to_m(char *line)
 
   move = _m(_chr_to_sq(line[0], line[1]), _chr_to_sq(line[2], line[3]));
   piece = 0;
-  if (strlen(line) > 5)
+  if (strlen(line) > 4)
     switch (line[4])
     {
       case 'q': piece = QUEEN; break;